@@ -0,0 +1,454 @@
+// Benchmarks.cpp
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <unordered_set>
+#include <cstring>
+
+#include "Solver.h"
+#include "Histogram.h"
+#include "LetterSignature.h"
+#include "WordTrie.h"
+#include "Hashing.h"
+#include "MD5.h"
+
+using namespace challenge::whiterabbithole;
+
+// Microbenchmarks of the solver kernels. Every result is printed as one JSON object per line
+// (JSON Lines), so that runs can be stored and compared across releases:
+// {"benchmark": "get_hash", "params": {"length": 16}, "iterations": 1048576, "ns_per_op": 151.2}
+// Usage: WhiteRabbitHole_bench [--filter TEXT] [--min-time SECONDS]
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Gives the benchmarks access to the solver stages.
+		/// </summary>
+		class SolverBenchmark
+		{
+		public:
+			static void set_words(Solver* solver, const std::vector<std::string>& words)
+			{
+				if (solver->words) delete solver->words;
+				solver->words = new Solver::wordset_t(words);
+			}
+
+			static void process_words(Solver* solver)
+			{
+				solver->process_words();
+			}
+
+			static size_t get_use_words_count(const Solver* solver)
+			{
+				return solver->use_words->size();
+			}
+
+			// The nodes one level above the leaves: walking one of them expands a single level
+			static std::vector<DispositionsTreeWalkState::disposition_t> get_last_level_prefixes(const Solver* solver)
+			{
+				unsigned int group_size = solver->get_phrase_words_count();
+				std::vector<DispositionsTreeWalkState::disposition_t> prefixes;
+				DispositionsTreeWalkState state;
+				set_budget(solver, &state);
+				solver->collect_prefixes(*(solver->use_words), group_size, group_size - 1, &state, &prefixes, true);
+				return prefixes;
+			}
+
+			static void set_budget(const Solver* solver, DispositionsTreeWalkState* state)
+			{
+				state->set_budget(solver->anagram_phrase, solver->anagram_phrase_layout);
+			}
+
+			static size_t walk_prefix(const Solver* solver, const DispositionsTreeWalkState::disposition_t& prefix,
+				DispositionsTreeWalkState* state)
+			{
+				unsigned int group_size = solver->get_phrase_words_count();
+				Solver::result_t result;
+				for (size_t i = 0; i < prefix.size(); i++)
+				{
+					solver->push_word(*(solver->use_words), group_size, state, prefix[i]);
+				}
+				solver->walk_combinations(*(solver->use_words), group_size, state, &result);
+				for (size_t i = 0; i < prefix.size(); i++)
+				{
+					solver->pop_word(*(solver->use_words), state);
+				}
+				return result.size();
+			}
+		}; // class SolverBenchmark
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+namespace {
+
+	const std::string benchmark_phrase = "poultry outwits ants";
+	const std::string benchmark_phrase_hash = "e4820b45d2277f3844eac66c903e84be";
+
+	std::string filter;
+	double min_time = 0.25;
+
+	// Keeps results alive so that the measured work is not optimized away
+	volatile size_t sink;
+
+	// Runs the body with more and more iterations until it lasts min_time, then prints the rate
+	void run_benchmark(const std::string& name, const std::string& params,
+		const std::function<void(size_t iterations)>& body)
+	{
+		if (!filter.empty() && name.find(filter) == std::string::npos)
+		{
+			return;
+		}
+
+		size_t iterations = 1;
+		double elapsed = 0;
+		while (true)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			body(iterations);
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (elapsed >= min_time || iterations >= ((size_t)1 << 40))
+			{
+				break;
+			}
+
+			// Aim past min_time, growing at most tenfold at once
+			double factor = elapsed > 0 ? 1.5 * min_time / elapsed : 10;
+			iterations = (size_t)(iterations * (factor < 10 ? (factor > 2 ? factor : 2) : 10));
+		}
+
+		std::cout << "{\"benchmark\": \"" << name << "\", \"params\": {" << params << "}, \"iterations\": " <<
+			iterations << ", \"ns_per_op\": " << elapsed * 1e9 / iterations << "}" << std::endl;
+	}
+
+	// Words of the given length, a tenth of them with a letter outside the phrase
+	std::vector<std::string> make_words(size_t count, size_t min_length, size_t max_length, unsigned int seed)
+	{
+		std::string letters;
+		for (std::string::const_iterator it = benchmark_phrase.begin(); it != benchmark_phrase.end(); it++)
+		{
+			if (*it != ' ') letters += *it;
+		}
+
+		std::mt19937 random(seed);
+		std::vector<std::string> words;
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t length = min_length + random() % (max_length - min_length + 1);
+			std::string word;
+			for (size_t j = 0; j < length; j++)
+			{
+				word += letters[random() % letters.length()];
+			}
+			if (random() % 10 == 0) word[random() % length] = 'z';
+			words.push_back(word);
+		}
+
+		return words;
+	}
+
+	std::string length_param(size_t length)
+	{
+		return "\"length\": " + std::to_string(length);
+	}
+
+	void run_histogram_benchmarks(const std::vector<size_t>& lengths)
+	{
+		for (std::vector<size_t>::const_iterator length = lengths.begin(); length != lengths.end(); length++)
+		{
+			std::vector<std::string> words = make_words(64, *length, *length, 1);
+			run_benchmark("histogram_construct", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					Histogram histogram(words[i & 63]);
+					total += histogram.get_count('t');
+				}
+				sink = total;
+			});
+
+			std::vector<Histogram> histograms;
+			for (std::vector<std::string>::const_iterator it = words.begin(); it != words.end(); it++)
+			{
+				histograms.push_back(Histogram(*it));
+			}
+			Histogram phrase_histogram(benchmark_phrase);
+
+			run_benchmark("histogram_equals", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					total += Histogram::equals(histograms[i & 63], histograms[(i + 1) & 63]);
+				}
+				sink = total;
+			});
+
+			run_benchmark("histogram_contains", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					total += Histogram::contains(phrase_histogram, histograms[i & 63]);
+				}
+				sink = total;
+			});
+		}
+	}
+
+	void run_signature_benchmarks(const std::vector<size_t>& lengths)
+	{
+		LetterSignatureLayout layout(benchmark_phrase);
+		for (std::vector<size_t>::const_iterator length = lengths.begin(); length != lengths.end(); length++)
+		{
+			std::vector<std::string> words = make_words(64, *length, *length, 1);
+			run_benchmark("signature_construct", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					const std::string& word = words[i & 63];
+					letter_signature_t signature;
+					total += layout.get_signature(word.c_str(), word.length(), &signature);
+				}
+				sink = total;
+			});
+
+			// Words overflowing a lane are given up early, their signature stays partial
+			std::vector<letter_signature_t> signatures(words.size());
+			for (size_t i = 0; i < words.size(); i++)
+			{
+				layout.get_signature(words[i].c_str(), words[i].length(), &signatures[i]);
+			}
+
+			run_benchmark("signature_contains", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					total += layout.contains(layout.get_phrase_signature(), signatures[i & 63]);
+				}
+				sink = total;
+			});
+		}
+	}
+
+	// One operation collects the classes spellable from the letters of the phrase
+	void run_trie_benchmarks(const std::vector<size_t>& vocabulary_sizes)
+	{
+		uint8_t phrase_counts[256] = { 0 };
+		for (std::string::const_iterator it = benchmark_phrase.begin(); it != benchmark_phrase.end(); it++)
+		{
+			if (*it != ' ') phrase_counts[(unsigned char)*it]++;
+		}
+
+		for (std::vector<size_t>::const_iterator size = vocabulary_sizes.begin(); size != vocabulary_sizes.end(); size++)
+		{
+			std::vector<std::string> words = make_words(*size, 2, 9, 5);
+			std::unordered_set<std::string> seen;
+			std::vector<word_trie_entry_t> entries;
+			for (std::vector<std::string>::const_iterator it = words.begin(); it != words.end(); it++)
+			{
+				std::string letters = *it;
+				std::sort(letters.begin(), letters.end());
+				if (!seen.insert(letters).second) continue;
+				word_trie_entry_t entry = { letters, (unsigned int)entries.size(), (unsigned int)entries.size() + 1 };
+				entries.push_back(entry);
+			}
+			WordTrie trie(entries);
+
+			std::vector<unsigned int> indices;
+			run_benchmark("trie_collect", "\"vocabulary\": " + std::to_string(*size), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					indices.clear();
+					trie.collect(phrase_counts, ~(uint64_t)0, 0, &indices);
+					total += indices.size();
+				}
+				sink = total;
+			});
+		}
+	}
+
+	void run_hash_benchmarks(const std::vector<size_t>& lengths)
+	{
+		for (std::vector<size_t>::const_iterator length = lengths.begin(); length != lengths.end(); length++)
+		{
+			std::vector<std::string> messages = make_words(64, *length, *length, 2);
+
+			run_benchmark("get_hash", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					total += get_hash(messages[i & 63]).length();
+				}
+				sink = total;
+			});
+
+			run_benchmark("md5_update_finalize", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					const std::string& message = messages[i & 63];
+					MD5 md5;
+					md5.update(message.c_str(), (MD5::size_type)message.length());
+					unsigned int words[4];
+					md5.finalize().digestwords(words);
+					total += words[0];
+				}
+				sink = total;
+			});
+
+			if (*length >= md5_single_block_limit)
+			{
+				continue;
+			}
+
+			// Batches of 64 messages against one target (early check), as strings and as the words
+			// of their blocks: one op is one message
+			HashVerifier verifier(get_hash_digest(make_words(1, *length, *length, 4).front()), *length);
+			std::vector<const char*> pointers;
+			std::vector<uint32_t> words(16 * 64);
+			for (size_t i = 0; i < 64; i++)
+			{
+				pointers.push_back(messages[i].c_str());
+				uint32_t block[16];
+				initialize_hash_block(*length, block);
+				memcpy(block, messages[i].data(), *length);
+				for (size_t k = 0; k < 16; k++)
+				{
+					words[k * 64 + i] = block[k];
+				}
+			}
+			int targets[64];
+
+			run_benchmark("verifier_match", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i += 64)
+				{
+					total += verifier.match(&(pointers[0]), 64, targets);
+				}
+				sink = total;
+			});
+
+			run_benchmark("verifier_match_words", length_param(*length), [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i += 64)
+				{
+					total += verifier.match_words(&(words[0]), 64, 64, targets);
+				}
+				sink = total;
+			});
+		}
+
+		std::vector<std::string> hashes;
+		std::vector<std::string> messages = make_words(64, 16, 16, 3);
+		for (std::vector<std::string>::const_iterator it = messages.begin(); it != messages.end(); it++)
+		{
+			hashes.push_back(get_hash(*it));
+		}
+		run_benchmark("compare_hashes", "", [&](size_t iterations)
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < iterations; i++)
+			{
+				total += compare_hashes(hashes[i & 63], hashes[(i + 7) & 63]);
+			}
+			sink = total;
+		});
+	}
+
+	void run_solver_benchmarks(const std::vector<size_t>& vocabulary_sizes)
+	{
+		std::ostream null_stream(0);
+		SolverOptions options;
+		options.log_level = LogLevel::Silent;
+
+		for (std::vector<size_t>::const_iterator size = vocabulary_sizes.begin(); size != vocabulary_sizes.end(); size++)
+		{
+			std::string params = "\"vocabulary\": " + std::to_string(*size);
+			std::vector<std::string> words = make_words(*size, 2, 9, 4);
+
+			Solver solver(benchmark_phrase, "", benchmark_phrase_hash, null_stream, options);
+			SolverBenchmark::set_words(&solver, words);
+			SolverBenchmark::process_words(&solver); // The walk needs the usewords, even when filtered out
+			run_benchmark("process_words", params, [&](size_t iterations)
+			{
+				for (size_t i = 0; i < iterations; i++)
+				{
+					SolverBenchmark::process_words(&solver);
+				}
+				sink = SolverBenchmark::get_use_words_count(&solver);
+			});
+
+			// One operation expands the last level below one node
+			std::vector<DispositionsTreeWalkState::disposition_t> prefixes =
+				SolverBenchmark::get_last_level_prefixes(&solver);
+			if (prefixes.empty())
+			{
+				continue;
+			}
+			DispositionsTreeWalkState state;
+			SolverBenchmark::set_budget(&solver, &state);
+			run_benchmark("walk_dispositions_level", params, [&](size_t iterations)
+			{
+				size_t total = 0;
+				for (size_t i = 0; i < iterations; i++)
+				{
+					total += SolverBenchmark::walk_prefix(&solver, prefixes[i % prefixes.size()], &state);
+				}
+				sink = total;
+			});
+		}
+	}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--filter" && i + 1 < argc)
+		{
+			filter = argv[++i];
+		}
+		else if (arg == "--min-time" && i + 1 < argc)
+		{
+			min_time = std::stod(argv[++i]);
+		}
+		else
+		{
+			std::cerr << "Unknown option: '" << arg << "'" << std::endl;
+			return 1;
+		}
+	}
+
+	// The context of the run comes first
+	std::cout << "{\"context\": {\"hash_kernel\": \"" << get_hash_kernel_name() << "\", \"hash_lanes\": " <<
+		get_hash_kernel_lanes() << "}}" << std::endl;
+
+	std::vector<size_t> lengths = { 4, 8, 16, 32, 64 };
+	run_histogram_benchmarks(lengths);
+	run_signature_benchmarks(lengths);
+	run_hash_benchmarks(lengths);
+
+	std::vector<size_t> vocabulary_sizes = { 1000, 10000, 100000 };
+	run_trie_benchmarks(vocabulary_sizes);
+	run_solver_benchmarks(vocabulary_sizes);
+
+	return 0;
+}
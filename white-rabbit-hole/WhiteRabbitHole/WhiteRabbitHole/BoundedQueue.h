@@ -0,0 +1,193 @@
+// BoundedQueue.h
+
+#ifndef BOUNDEDQUEUE_H_
+#define BOUNDEDQUEUE_H_
+
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Multi-producer multi-consumer queue of fixed capacity, lock-free: every slot carries a
+		/// sequence number telling producers and consumers whose turn it is (D. Vyukov's design).
+		/// Values are moved in and out of the slots.
+		/// </summary>
+		template <typename T>
+		class BoundedQueue
+		{
+		private:
+			struct Cell {
+				std::atomic<size_t> sequence;
+				T value;
+			};
+
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="capacity">The capacity, rounded up to a power of two.</param>
+			BoundedQueue(size_t capacity);
+
+			/// <summary>
+			/// Destroys an instance of this class.
+			/// </summary>
+			~BoundedQueue();
+
+		private:
+			BoundedQueue(const BoundedQueue& other);
+
+		private:
+			Cell* cells;
+			size_t mask;
+			// Producers and consumers do not false-share their positions
+			char padding1[64];
+			std::atomic<size_t> enqueue_position;
+			char padding2[64];
+			std::atomic<size_t> dequeue_position;
+			char padding3[64];
+
+		public:
+			/// <summary>
+			/// Tries to enqueue a value.
+			/// </summary>
+			/// <param name="value">The value, moved from on success.</param>
+			/// <returns>False when the queue is full.</returns>
+			bool try_push(T& value);
+
+			/// <summary>
+			/// Enqueues a value, waiting while the queue is full (backpressure on producers).
+			/// </summary>
+			/// <param name="value">The value, moved from.</param>
+			void push(T& value);
+
+			/// <summary>
+			/// Tries to dequeue a value.
+			/// </summary>
+			/// <param name="value">Receives the value.</param>
+			/// <returns>False when the queue is empty.</returns>
+			bool try_pop(T* value);
+
+			/// <summary>
+			/// Waits for a while after a failed attempt: spins first, then yields, then sleeps.
+			/// </summary>
+			/// <param name="attempt">The number of consecutive failed attempts.</param>
+			static void back_off(unsigned int attempt);
+		}; // class BoundedQueue
+
+		// Ctors
+
+		template <typename T>
+		BoundedQueue<T>::BoundedQueue(size_t capacity)
+		{
+			size_t size = 2;
+			while (size < capacity) size <<= 1;
+
+			this->cells = new Cell[size];
+			this->mask = size - 1;
+			for (size_t i = 0; i < size; i++)
+			{
+				this->cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			this->enqueue_position.store(0, std::memory_order_relaxed);
+			this->dequeue_position.store(0, std::memory_order_relaxed);
+		}
+
+		template <typename T>
+		BoundedQueue<T>::~BoundedQueue()
+		{
+			delete[] this->cells;
+		}
+
+		// Public methods
+
+		// A slot is free for the producer at position p when its sequence is p, and holds a
+		// value for the consumer at position p when its sequence is p + 1
+		template <typename T>
+		bool BoundedQueue<T>::try_push(T& value)
+		{
+			size_t position = this->enqueue_position.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Cell* cell = &(this->cells[position & this->mask]);
+				ptrdiff_t difference = (ptrdiff_t)cell->sequence.load(std::memory_order_acquire) - (ptrdiff_t)position;
+				if (difference == 0)
+				{
+					if (this->enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						cell->value = std::move(value);
+						cell->sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+				{
+					return false; // Full
+				}
+				else
+				{
+					position = this->enqueue_position.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		template <typename T>
+		void BoundedQueue<T>::push(T& value)
+		{
+			for (unsigned int attempt = 0; !this->try_push(value); attempt++)
+			{
+				back_off(attempt);
+			}
+		}
+
+		template <typename T>
+		bool BoundedQueue<T>::try_pop(T* value)
+		{
+			size_t position = this->dequeue_position.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Cell* cell = &(this->cells[position & this->mask]);
+				ptrdiff_t difference = (ptrdiff_t)cell->sequence.load(std::memory_order_acquire) - (ptrdiff_t)(position + 1);
+				if (difference == 0)
+				{
+					if (this->dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						*value = std::move(cell->value);
+						cell->sequence.store(position + this->mask + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+				{
+					return false; // Empty
+				}
+				else
+				{
+					position = this->dequeue_position.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		template <typename T>
+		void BoundedQueue<T>::back_off(unsigned int attempt)
+		{
+			if (attempt < 16)
+			{
+				return;
+			}
+			if (attempt < 64)
+			{
+				std::this_thread::yield();
+				return;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
@@ -0,0 +1,24 @@
+// CancelToken.cpp
+
+#include "CancelToken.h"
+
+using namespace challenge::whiterabbithole;
+
+// Ctors
+
+CancelToken::CancelToken()
+{
+	this->cancelled.store(false);
+}
+
+// Public methods
+
+void CancelToken::cancel()
+{
+	this->cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool CancelToken::is_cancelled() const
+{
+	return this->cancelled.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,44 @@
+// CancelToken.h
+
+#ifndef CANCELTOKEN_H_
+#define CANCELTOKEN_H_
+
+#include <atomic>
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Lets another thread (or a signal handler) ask a running solver to stop.
+		/// The solver polls it cooperatively and returns the results found so far.
+		/// </summary>
+		class CancelToken
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			CancelToken();
+
+		private:
+			CancelToken(const CancelToken& other);
+
+		private:
+			std::atomic<bool> cancelled;
+
+		public:
+			/// <summary>
+			/// Requests the cancellation.
+			/// </summary>
+			void cancel();
+
+			/// <summary>
+			/// Gets a value indicating whether the cancellation has been requested.
+			/// </summary>
+			bool is_cancelled() const;
+		}; // class CancelToken
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
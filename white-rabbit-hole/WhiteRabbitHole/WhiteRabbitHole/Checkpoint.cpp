@@ -0,0 +1,500 @@
+// Checkpoint.cpp
+
+#include <exception>
+#include <cstdio>
+#include <fstream>
+
+#include "Checkpoint.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+using namespace challenge::whiterabbithole;
+
+static const char* checkpoint_header = "WhiteRabbitHole-checkpoint 4";
+static const char* candidates_header = "WhiteRabbitHole-candidates 1";
+
+// Ctors
+
+Checkpoint::Checkpoint(const std::string& path, const std::string& fingerprint,
+	std::chrono::seconds save_interval)
+{
+	this->path = path;
+	this->fingerprint = fingerprint;
+	this->candidates_path = path + "." + fingerprint + ".candidates";
+	this->save_interval = save_interval;
+	this->last_save = std::chrono::steady_clock::now();
+	this->phase = 0;
+	this->task_count = 0;
+	this->split_depth = 0;
+	this->pending_count = 0;
+	this->outputs_count = 0;
+	this->outputs_size = 0;
+}
+
+// Public methods
+
+bool Checkpoint::load()
+{
+	std::ifstream file(this->path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> saving(this->save_lock);
+	std::lock_guard<std::mutex> guard(this->lock);
+
+	std::string line;
+	std::getline(file, line);
+	if (line != checkpoint_header)
+	{
+		throw std::exception("Malformed checkpoint file");
+	}
+
+	std::string key, value;
+	file >> key >> value;
+	if (key != "fingerprint")
+	{
+		throw std::exception("Malformed checkpoint file");
+	}
+	if (value != this->fingerprint)
+	{
+		throw std::exception("Checkpoint does not match the phrase, hashes or vocabulary");
+	}
+
+	file >> key >> this->phase >> this->task_count;
+	if (key != "phase")
+	{
+		throw std::exception("Malformed checkpoint file");
+	}
+
+	file >> key >> this->split_depth;
+	if (key != "split_depth")
+	{
+		throw std::exception("Malformed checkpoint file");
+	}
+
+	// Tasks in progress are just run again
+	size_t workers_count;
+	file >> key >> workers_count;
+	this->worker_tasks.assign(workers_count, -1);
+	for (size_t i = 0; i < workers_count; i++)
+	{
+		file >> this->worker_tasks[i];
+	}
+
+	// Done tasks are stored as ranges
+	size_t ranges_count;
+	file >> key >> ranges_count;
+	this->completed.assign(this->task_count, false);
+	for (size_t i = 0; i < ranges_count; i++)
+	{
+		size_t begin, end;
+		file >> begin >> end;
+		if (!file || end > this->task_count)
+		{
+			throw std::exception("Malformed checkpoint file");
+		}
+		for (size_t task = begin; task < end; task++)
+		{
+			this->completed[task] = true;
+		}
+	}
+
+	file >> key >> this->outputs_count >> this->outputs_size;
+	if (!file || key != "outputs")
+	{
+		throw std::exception("Malformed checkpoint file");
+	}
+
+	// Only the entries covered by the checkpoint are read, a crash may have left more
+	this->outputs.clear();
+	this->pending_outputs.clear();
+	this->pending_count = 0;
+	if (this->outputs_count > 0)
+	{
+		std::ifstream log(this->get_outputs_path(this->phase), std::ios::binary);
+		if (!log.is_open())
+		{
+			throw std::exception("Missing checkpoint outputs file");
+		}
+		for (size_t i = 0; i < this->outputs_count; i++)
+		{
+			size_t task, phrases_count;
+			log >> task >> phrases_count;
+			if (!log || task >= this->task_count || !this->completed[task])
+			{
+				throw std::exception("Malformed checkpoint outputs file");
+			}
+			std::vector<phrase_t>& output = this->outputs[task];
+			for (size_t j = 0; j < phrases_count; j++)
+			{
+				output.push_back(read_phrase(log));
+			}
+		}
+	}
+
+	return true;
+}
+
+void Checkpoint::save()
+{
+	// One save at a time: the workers only wait while the progress is copied, not while it is written
+	std::lock_guard<std::mutex> saving(this->save_lock);
+	unsigned int phase;
+	size_t task_count;
+	unsigned int split_depth;
+	std::vector<bool> completed;
+	std::vector<long long> worker_tasks;
+	std::string pending_outputs;
+	size_t pending_count;
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		phase = this->phase;
+		task_count = this->task_count;
+		split_depth = this->split_depth;
+		completed = this->completed;
+		worker_tasks = this->worker_tasks;
+		pending_outputs.swap(this->pending_outputs);
+		pending_count = this->pending_count;
+		this->pending_count = 0;
+		this->last_save = std::chrono::steady_clock::now();
+	}
+
+	// The new outputs go after the entries covered by the previous checkpoint (overwriting what
+	// a crash may have left there), a new phase starts its log over
+	std::string outputs_path = this->get_outputs_path(phase);
+	{
+		std::fstream log;
+		if (this->outputs_size > 0)
+		{
+			log.open(outputs_path, std::ios::binary | std::ios::in | std::ios::out);
+			log.seekp(this->outputs_size);
+		}
+		else
+		{
+			log.open(outputs_path, std::ios::binary | std::ios::out | std::ios::trunc);
+		}
+		if (!log.is_open())
+		{
+			throw std::exception("Could not write checkpoint outputs file");
+		}
+
+		if (!log.write(pending_outputs.data(), pending_outputs.size()).flush())
+		{
+			throw std::exception("Could not write checkpoint outputs file");
+		}
+		this->outputs_count += pending_count;
+		this->outputs_size = (size_t)log.tellp();
+	}
+
+	std::string temp_path = this->path + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			throw std::exception("Could not write checkpoint file");
+		}
+
+		file << checkpoint_header << "\n";
+		file << "fingerprint " << this->fingerprint << "\n";
+		file << "phase " << phase << " " << task_count << "\n";
+		file << "split_depth " << split_depth << "\n";
+
+		file << "workers " << worker_tasks.size();
+		for (std::vector<long long>::const_iterator it = worker_tasks.begin(); it != worker_tasks.end(); it++)
+		{
+			file << " " << *it;
+		}
+		file << "\n";
+
+		std::vector<std::pair<size_t, size_t>> ranges;
+		for (size_t task = 0; task < task_count; task++)
+		{
+			if (!completed[task]) continue;
+			if (!ranges.empty() && ranges.back().second == task) ranges.back().second++;
+			else ranges.push_back(std::make_pair(task, task + 1));
+		}
+		file << "completed " << ranges.size() << "\n";
+		for (std::vector<std::pair<size_t, size_t>>::const_iterator it = ranges.begin(); it != ranges.end(); it++)
+		{
+			file << it->first << " " << it->second << "\n";
+		}
+
+		file << "outputs " << this->outputs_count << " " << this->outputs_size << "\n";
+
+		if (!file.flush())
+		{
+			throw std::exception("Could not write checkpoint file");
+		}
+	}
+
+	// The previous checkpoint is only replaced by a complete one, in a single step
+	if (!replace_file(temp_path, this->path))
+	{
+		throw std::exception("Could not write checkpoint file");
+	}
+
+	// No checkpoint refers to the log of the previous phase any more
+	if (phase > 1)
+	{
+		std::remove(this->get_outputs_path(phase - 1).c_str());
+	}
+}
+
+// The first worker finding the save due claims it, the others keep working
+void Checkpoint::save_if_due()
+{
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - this->last_save < this->save_interval)
+		{
+			return;
+		}
+		this->last_save = now;
+	}
+
+	this->save();
+}
+
+void Checkpoint::remove()
+{
+	std::lock_guard<std::mutex> saving(this->save_lock);
+	std::remove(this->path.c_str());
+	std::remove((this->path + ".tmp").c_str());
+	std::remove(this->candidates_path.c_str());
+	std::remove((this->candidates_path + ".tmp").c_str());
+	std::remove(this->get_outputs_path(1).c_str());
+	std::remove(this->get_outputs_path(2).c_str());
+}
+
+unsigned int Checkpoint::get_phase() const
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	return this->phase;
+}
+
+void Checkpoint::start_phase(unsigned int phase, size_t task_count)
+{
+	std::lock_guard<std::mutex> saving(this->save_lock);
+	std::lock_guard<std::mutex> guard(this->lock);
+	if (this->phase == phase && this->task_count == task_count)
+	{
+		return;
+	}
+
+	this->phase = phase;
+	this->task_count = task_count;
+	this->completed.assign(task_count, false);
+	this->outputs.clear();
+	this->pending_outputs.clear();
+	this->pending_count = 0;
+	this->outputs_count = 0;
+	this->outputs_size = 0;
+	this->worker_tasks.clear();
+}
+
+unsigned int Checkpoint::get_split_depth() const
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	return this->split_depth;
+}
+
+void Checkpoint::set_split_depth(unsigned int split_depth)
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	this->split_depth = split_depth;
+}
+
+size_t Checkpoint::get_completed_count() const
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	size_t count = 0;
+	for (size_t task = 0; task < this->task_count; task++)
+	{
+		if (this->completed[task]) count++;
+	}
+	return count;
+}
+
+bool Checkpoint::is_task_completed(size_t task) const
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	return task < this->task_count && this->completed[task];
+}
+
+void Checkpoint::begin_task(unsigned int worker, size_t task)
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	if (this->worker_tasks.size() <= worker)
+	{
+		this->worker_tasks.resize(worker + 1, -1);
+	}
+	this->worker_tasks[worker] = (long long)task;
+}
+
+// The log entry is formatted before the lock is taken, the save only writes the entries out
+void Checkpoint::complete_task(unsigned int worker, size_t task,
+	std::vector<phrase_t>::const_iterator output_begin, std::vector<phrase_t>::const_iterator output_end)
+{
+	std::string entry;
+	if (output_begin != output_end)
+	{
+		entry = std::to_string(task) + " " + std::to_string(output_end - output_begin) + "\n";
+		for (std::vector<phrase_t>::const_iterator it = output_begin; it != output_end; it++)
+		{
+			write_phrase(&entry, *it);
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(this->lock);
+	if (task >= this->task_count)
+	{
+		return;
+	}
+
+	this->completed[task] = true;
+	if (!entry.empty())
+	{
+		this->pending_outputs += entry;
+		this->pending_count++;
+	}
+	if (worker < this->worker_tasks.size())
+	{
+		this->worker_tasks[worker] = -1;
+	}
+}
+
+std::map<size_t, std::vector<phrase_t>> Checkpoint::get_outputs() const
+{
+	std::lock_guard<std::mutex> guard(this->lock);
+	return this->outputs;
+}
+
+std::vector<phrase_t> Checkpoint::get_candidates() const
+{
+	std::ifstream file(this->candidates_path, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::exception("Missing checkpoint candidates file");
+	}
+
+	std::string line, key, value;
+	std::getline(file, line);
+	file >> key >> value;
+	if (line != candidates_header || key != "fingerprint" || value != this->fingerprint)
+	{
+		throw std::exception("Malformed checkpoint candidates file");
+	}
+
+	size_t candidates_count;
+	file >> key >> candidates_count;
+	if (!file || key != "candidates")
+	{
+		throw std::exception("Malformed checkpoint candidates file");
+	}
+	std::vector<phrase_t> candidates;
+	candidates.reserve(candidates_count);
+	for (size_t i = 0; i < candidates_count; i++)
+	{
+		candidates.push_back(read_phrase(file));
+	}
+
+	return candidates;
+}
+
+// The file is complete before phase 2 is saved, and no save of phase 2 rewrites it
+void Checkpoint::set_candidates(const std::vector<phrase_t>& candidates)
+{
+	std::string temp_path = this->candidates_path + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			throw std::exception("Could not write checkpoint candidates file");
+		}
+
+		file << candidates_header << "\n";
+		file << "fingerprint " << this->fingerprint << "\n";
+		file << "candidates " << candidates.size() << "\n";
+		std::string buffer;
+		for (std::vector<phrase_t>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
+		{
+			buffer.clear();
+			write_phrase(&buffer, *it);
+			file.write(buffer.data(), buffer.size());
+		}
+
+		if (!file.flush())
+		{
+			throw std::exception("Could not write checkpoint candidates file");
+		}
+	}
+
+	if (!replace_file(temp_path, this->candidates_path))
+	{
+		throw std::exception("Could not write checkpoint candidates file");
+	}
+}
+
+// Private methods
+
+std::string Checkpoint::get_outputs_path(unsigned int phase) const
+{
+	return this->path + "." + this->fingerprint + ".outputs" + std::to_string(phase);
+}
+
+// On POSIX rename replaces the target atomically, on Windows it fails when the target exists
+bool Checkpoint::replace_file(const std::string& source_path, const std::string& target_path)
+{
+#ifdef _WIN32
+	return MoveFileExA(source_path.c_str(), target_path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return std::rename(source_path.c_str(), target_path.c_str()) == 0;
+#endif
+}
+
+// Words are length-prefixed: "2 5:stout 4:ants"
+void Checkpoint::write_phrase(std::string* buffer, const phrase_t& phrase)
+{
+	*buffer += std::to_string(phrase.size());
+	for (phrase_t::const_iterator it = phrase.begin(); it != phrase.end(); it++)
+	{
+		*buffer += " ";
+		*buffer += std::to_string(it->length());
+		*buffer += ":";
+		*buffer += *it;
+	}
+	*buffer += "\n";
+}
+
+phrase_t Checkpoint::read_phrase(std::istream& stream)
+{
+	phrase_t phrase;
+	size_t words_count;
+	stream >> words_count;
+	for (size_t i = 0; i < words_count && stream; i++)
+	{
+		size_t length;
+		stream >> length;
+		if (stream.get() != ':')
+		{
+			throw std::exception("Malformed checkpoint file");
+		}
+
+		std::string word(length, '\0');
+		if (length > 0) stream.read(&word[0], length);
+		phrase.push_back(word);
+	}
+
+	if (!stream)
+	{
+		throw std::exception("Malformed checkpoint file");
+	}
+	return phrase;
+}
@@ -0,0 +1,158 @@
+// Checkpoint.h
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+
+#include "Common.h"
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Progress of a solve saved to a file, so that it can resume after a crash.
+		/// Each phase is a set of indexed tasks: the checkpoint records the phase, which tasks
+		/// are done and the task each worker is running. The output of the tasks (candidates or
+		/// valid phrases) is appended to a log per phase, and the candidates found by phase 1 are
+		/// written once: both are sibling files named by the fingerprint, so a save only writes
+		/// what is new. A fingerprint of the phrase, the hashes and the vocabulary guards against
+		/// resuming a different search.
+		/// All methods can be called from several threads, a save only holds the workers while
+		/// the progress is copied.
+		/// </summary>
+		class Checkpoint
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class, starting from no progress.
+			/// </summary>
+			/// <param name="path">The checkpoint file.</param>
+			/// <param name="fingerprint">Identifies the search (fx: a hash of its inputs).</param>
+			/// <param name="save_interval">The minimum time between two periodic saves.</param>
+			Checkpoint(const std::string& path, const std::string& fingerprint,
+				std::chrono::seconds save_interval);
+
+		private:
+			Checkpoint(const Checkpoint& other);
+
+		private:
+			std::string path;
+			std::string fingerprint;
+			std::chrono::seconds save_interval;
+			std::chrono::steady_clock::time_point last_save;
+			mutable std::mutex lock;
+			std::mutex save_lock; // Taken before lock, by the save and the phase changes
+			unsigned int phase;
+			size_t task_count;
+			unsigned int split_depth;
+			std::vector<bool> completed;
+			std::map<size_t, std::vector<phrase_t>> outputs; // Restored by load
+			std::string pending_outputs; // Log entries not written yet
+			size_t pending_count;
+			size_t outputs_count; // Entries of the log covered by the checkpoint
+			size_t outputs_size; // Bytes of the log covered by the checkpoint
+			std::vector<long long> worker_tasks;
+			std::string candidates_path;
+
+		public:
+			/// <summary>
+			/// Loads the checkpoint file, if any.
+			/// Throws when it is malformed or its fingerprint differs.
+			/// </summary>
+			/// <returns>False when there is no checkpoint file.</returns>
+			bool load();
+
+			/// <summary>
+			/// Appends the output of the tasks done since the last save to the log, then writes
+			/// the checkpoint file (to a temporary file first, then renamed).
+			/// </summary>
+			void save();
+
+			/// <summary>
+			/// Saves if the save interval has elapsed since the last save.
+			/// </summary>
+			void save_if_due();
+
+			/// <summary>
+			/// Gets the phase in progress (0 when nothing was done).
+			/// </summary>
+			unsigned int get_phase() const;
+
+			/// <summary>
+			/// Moves to a phase. Progress is kept when already in that phase (resuming),
+			/// otherwise it is cleared.
+			/// </summary>
+			/// <param name="phase">The phase.</param>
+			/// <param name="task_count">The number of tasks of the phase.</param>
+			void start_phase(unsigned int phase, size_t task_count);
+
+			/// <summary>
+			/// Gets the split depth phase 1 was divided into tasks with (0 when not recorded).
+			/// </summary>
+			unsigned int get_split_depth() const;
+
+			/// <summary>
+			/// Records the split depth phase 1 is divided into tasks with: the tasks of a resumed
+			/// phase 1 are the same only when split the same way.
+			/// </summary>
+			void set_split_depth(unsigned int split_depth);
+
+			/// <summary>
+			/// Gets the number of tasks of the phase that are done.
+			/// </summary>
+			size_t get_completed_count() const;
+
+			/// <summary>
+			/// Gets a value indicating whether a task of the phase is done.
+			/// </summary>
+			bool is_task_completed(size_t task) const;
+
+			/// <summary>
+			/// Records the task a worker starts.
+			/// </summary>
+			void begin_task(unsigned int worker, size_t task);
+
+			/// <summary>
+			/// Records a task as done, with its output.
+			/// </summary>
+			void complete_task(unsigned int worker, size_t task,
+				std::vector<phrase_t>::const_iterator output_begin, std::vector<phrase_t>::const_iterator output_end);
+
+			/// <summary>
+			/// Removes the checkpoint file along with its sibling files, once the search is complete.
+			/// </summary>
+			void remove();
+
+			/// <summary>
+			/// Gets the output of the tasks done before the checkpoint was loaded, by task.
+			/// </summary>
+			std::map<size_t, std::vector<phrase_t>> get_outputs() const;
+
+			/// <summary>
+			/// Reads the candidates found by phase 1 from their file.
+			/// Throws when it is missing or malformed.
+			/// </summary>
+			std::vector<phrase_t> get_candidates() const;
+
+			/// <summary>
+			/// Writes the candidates found by phase 1 to their file, before phase 2 starts.
+			/// </summary>
+			void set_candidates(const std::vector<phrase_t>& candidates);
+
+		private:
+			std::string get_outputs_path(unsigned int phase) const;
+			static bool replace_file(const std::string& source_path, const std::string& target_path);
+			static void write_phrase(std::string* buffer, const phrase_t& phrase);
+			static phrase_t read_phrase(std::istream& stream);
+		}; // class Checkpoint
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
@@ -0,0 +1,51 @@
+// Cpu.cpp
+
+#include "Cpu.h"
+
+#if defined(WHITERABBITHOLE_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace challenge::whiterabbithole;
+
+static CpuFeatures detect_cpu_features()
+{
+	CpuFeatures features = { false, false, false };
+
+#if defined(WHITERABBITHOLE_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	features.sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	// The OS must save the YMM (and ZMM) registers on context switch
+	unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool os_ymm = (xcr0 & 0x6) == 0x6;
+	bool os_zmm = (xcr0 & 0xE6) == 0xE6;
+
+	if (max_leaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		features.avx2 = avx && os_ymm && (info[1] & (1 << 5)) != 0;
+		features.avx512f = os_zmm && (info[1] & (1 << 16)) != 0;
+	}
+#elif defined(WHITERABBITHOLE_X86)
+	// GCC and Clang also check the OS support
+	__builtin_cpu_init();
+	features.sse2 = __builtin_cpu_supports("sse2") != 0;
+	features.avx2 = __builtin_cpu_supports("avx2") != 0;
+	features.avx512f = __builtin_cpu_supports("avx512f") != 0;
+#endif
+
+	return features;
+}
+
+const CpuFeatures& challenge::whiterabbithole::get_cpu_features()
+{
+	static const CpuFeatures features = detect_cpu_features();
+	return features;
+}
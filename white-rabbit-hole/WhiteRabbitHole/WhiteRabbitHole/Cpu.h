@@ -0,0 +1,34 @@
+// Cpu.h
+
+#ifndef CPU_H_
+#define CPU_H_
+
+// x86 targets get SIMD kernels selected at runtime
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WHITERABBITHOLE_X86
+#endif
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Describes the instruction set extensions available at runtime.
+		/// </summary>
+		struct CpuFeatures {
+		public:
+			bool sse2;
+			bool avx2;
+			bool avx512f;
+		};
+
+		/// <summary>
+		/// Gets the instruction set extensions supported by both the CPU and the OS.
+		/// Detection runs once.
+		/// </summary>
+		/// <returns>The available features.</returns>
+		const CpuFeatures& get_cpu_features();
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
@@ -1,9 +1,128 @@
 // Hashing.cpp
 
 #include <ctype.h>
+#include <cstdio>
+#include <cstring>
 
 #include "Hashing.h"
 #include "MD5.h"
+#include "MD5Lanes.h"
+#include "MD5Kernels.h"
+
+using namespace challenge::whiterabbithole;
+
+namespace {
+
+	// Single lane, used when no SIMD kernel is available
+	struct ScalarLanes {
+		typedef uint32_t vec_t;
+		static const size_t lanes = 1;
+
+		static inline vec_t load(const uint32_t* p) { return *p; }
+		static inline void store(uint32_t* p, vec_t v) { *p = v; }
+		static inline vec_t set1(uint32_t v) { return v; }
+		static inline vec_t add(vec_t a, vec_t b) { return a + b; }
+		template <int n> static inline vec_t rotl(vec_t x) { return (x << n) | (x >> (32 - n)); }
+
+		static inline vec_t f(vec_t x, vec_t y, vec_t z) { return (x & y) | (~x & z); }
+		static inline vec_t g(vec_t x, vec_t y, vec_t z) { return (x & z) | (y & ~z); }
+		static inline vec_t h(vec_t x, vec_t y, vec_t z) { return x ^ y ^ z; }
+		static inline vec_t i(vec_t x, vec_t y, vec_t z) { return y ^ (x | ~z); }
+		static inline uint32_t eq_mask(vec_t a, vec_t b) { return a == b ? 1 : 0; }
+	};
+
+	typedef void (*md5_kernel_t)(const char* const* messages, const size_t* lengths, digest_t* digests);
+	typedef uint32_t (*md5_early_check_kernel_t)(const char* const* messages, const size_t* lengths,
+		const md5_early_check_t& check);
+	typedef void (*md5_words_kernel_t)(const uint32_t* words, size_t stride, digest_t* digests);
+	typedef uint32_t (*md5_early_check_words_kernel_t)(const uint32_t* words, size_t stride,
+		const md5_early_check_t& check);
+
+	struct Md5Kernel {
+		md5_kernel_t hash;
+		md5_early_check_kernel_t early_check;
+		md5_words_kernel_t hash_words;
+		md5_early_check_words_kernel_t early_check_words;
+		size_t lanes;
+		const char* name;
+	};
+
+	void md5_hash_scalar(const char* const* messages, const size_t* lengths, digest_t* digests)
+	{
+		md5_lanes_hash<ScalarLanes>(messages, lengths, digests);
+	}
+
+	uint32_t md5_early_check_scalar(const char* const* messages, const size_t* lengths,
+		const md5_early_check_t& check)
+	{
+		return md5_lanes_early_check<ScalarLanes>(messages, lengths, check);
+	}
+
+	void md5_hash_words_scalar(const uint32_t* words, size_t stride, digest_t* digests)
+	{
+		md5_lanes_hash_words<ScalarLanes>(words, stride, digests);
+	}
+
+	uint32_t md5_early_check_words_scalar(const uint32_t* words, size_t stride, const md5_early_check_t& check)
+	{
+		return md5_lanes_early_check_words<ScalarLanes>(words, stride, check);
+	}
+
+	inline uint32_t rotate_right(uint32_t x, int n)
+	{
+		return (x >> n) | (x << (32 - n));
+	}
+
+	Md5Kernel select_md5_kernel()
+	{
+#ifdef WHITERABBITHOLE_X86
+		const CpuFeatures& features = get_cpu_features();
+		if (features.avx512f)
+		{
+			Md5Kernel kernel = { md5_hash_avx512, md5_early_check_avx512, md5_hash_words_avx512,
+				md5_early_check_words_avx512, 16, "avx512" };
+			return kernel;
+		}
+		if (features.avx2)
+		{
+			Md5Kernel kernel = { md5_hash_avx2, md5_early_check_avx2, md5_hash_words_avx2,
+				md5_early_check_words_avx2, 8, "avx2" };
+			return kernel;
+		}
+		if (features.sse2)
+		{
+			Md5Kernel kernel = { md5_hash_sse2, md5_early_check_sse2, md5_hash_words_sse2,
+				md5_early_check_words_sse2, 4, "sse2" };
+			return kernel;
+		}
+#endif
+		Md5Kernel kernel = { md5_hash_scalar, md5_early_check_scalar, md5_hash_words_scalar,
+			md5_early_check_words_scalar, 1, "scalar" };
+		return kernel;
+	}
+
+	const Md5Kernel& get_md5_kernel()
+	{
+		static const Md5Kernel kernel = select_md5_kernel();
+		return kernel;
+	}
+
+	// Any length, through the generic implementation
+	void md5_hash_message(const char* message, size_t length, digest_t* digest)
+	{
+		MD5 md5;
+		md5.update(message, (MD5::size_type)length);
+		md5.finalize();
+
+		unsigned int words[4];
+		md5.digestwords(words);
+		for (size_t j = 0; j < 4; j++)
+		{
+			digest->words[j] = words[j];
+		}
+	}
+
+} // namespace
 
 std::string challenge::whiterabbithole::get_hash(const std::string& str)
 {
@@ -12,6 +131,167 @@ std::string challenge::whiterabbithole::get_hash(const std::string& str)
 	return digest;
 }
 
+digest_t challenge::whiterabbithole::get_hash_digest(const char* message, size_t length)
+{
+	digest_t digest;
+	if (length < md5_single_block_limit)
+	{
+		md5_hash_scalar(&message, &length, &digest);
+	}
+	else
+	{
+		md5_hash_message(message, length, &digest);
+	}
+
+	return digest;
+}
+
+digest_t challenge::whiterabbithole::get_hash_digest(const std::string& str)
+{
+	return get_hash_digest(str.c_str(), str.length());
+}
+
+void challenge::whiterabbithole::get_hashes(const char* const* messages, const size_t* lengths, size_t count,
+	digest_t* digests)
+{
+	const Md5Kernel& kernel = get_md5_kernel();
+
+	// Single-block messages are queued into the lanes of the kernel
+	const char* lane_messages[16];
+	size_t lane_lengths[16];
+	size_t lane_indices[16];
+	digest_t lane_digests[16];
+	size_t used = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (lengths[i] >= md5_single_block_limit)
+		{
+			md5_hash_message(messages[i], lengths[i], &(digests[i]));
+			continue;
+		}
+
+		lane_messages[used] = messages[i];
+		lane_lengths[used] = lengths[i];
+		lane_indices[used] = i;
+		if (++used < kernel.lanes)
+		{
+			continue;
+		}
+
+		kernel.hash(lane_messages, lane_lengths, lane_digests);
+		for (size_t lane = 0; lane < used; lane++)
+		{
+			digests[lane_indices[lane]] = lane_digests[lane];
+		}
+		used = 0;
+	}
+
+	if (used > 0)
+	{
+		// Idle lanes hash the empty message
+		for (size_t lane = used; lane < kernel.lanes; lane++)
+		{
+			lane_messages[lane] = "";
+			lane_lengths[lane] = 0;
+		}
+
+		kernel.hash(lane_messages, lane_lengths, lane_digests);
+		for (size_t lane = 0; lane < used; lane++)
+		{
+			digests[lane_indices[lane]] = lane_digests[lane];
+		}
+	}
+}
+
+std::vector<digest_t> challenge::whiterabbithole::get_hashes(const std::vector<std::string>& messages)
+{
+	std::vector<const char*> pointers(messages.size());
+	std::vector<size_t> lengths(messages.size());
+	for (size_t i = 0; i < messages.size(); i++)
+	{
+		pointers[i] = messages[i].c_str();
+		lengths[i] = messages[i].length();
+	}
+
+	std::vector<digest_t> digests(messages.size());
+	if (messages.size() > 0)
+	{
+		get_hashes(&(pointers[0]), &(lengths[0]), messages.size(), &(digests[0]));
+	}
+
+	return digests;
+}
+
+void challenge::whiterabbithole::initialize_hash_block(size_t length, uint32_t block[16])
+{
+	memset(block, 0, 16 * sizeof(uint32_t));
+	((unsigned char*)block)[length] = 0x80;
+	block[14] = (uint32_t)(length << 3);
+}
+
+const char* challenge::whiterabbithole::get_hash_kernel_name()
+{
+	return get_md5_kernel().name;
+}
+
+size_t challenge::whiterabbithole::get_hash_kernel_lanes()
+{
+	return get_md5_kernel().lanes;
+}
+
+std::string challenge::whiterabbithole::digest_to_string(const digest_t& digest)
+{
+	char buf[33];
+	for (int i = 0; i < 16; i++)
+	{
+		unsigned int byte = (digest.words[i / 4] >> (8 * (i % 4))) & 0xff;
+		sprintf(buf + i * 2, "%02x", byte);
+	}
+	buf[32] = 0;
+
+	return std::string(buf);
+}
+
+bool challenge::whiterabbithole::parse_hash(const std::string& hash, digest_t* digest)
+{
+	if (hash.length() != 32)
+	{
+		return false;
+	}
+
+	uint32_t words[4] = { 0, 0, 0, 0 };
+	for (size_t i = 0; i < 32; i++)
+	{
+		char c = hash[i];
+		uint32_t nibble;
+		if (c >= '0' && c <= '9') nibble = c - '0';
+		else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+		else return false;
+
+		// Two digits per byte (high nibble first), bytes are little-endian in the words
+		size_t byte = i / 2;
+		uint32_t shift = (uint32_t)(8 * (byte % 4) + (i % 2 == 0 ? 4 : 0));
+		words[byte / 4] |= nibble << shift;
+	}
+
+	for (size_t j = 0; j < 4; j++)
+	{
+		digest->words[j] = words[j];
+	}
+	return true;
+}
+
+bool challenge::whiterabbithole::compare_digests(const digest_t& digest1, const digest_t& digest2)
+{
+	uint64_t v1[2], v2[2];
+	memcpy(v1, digest1.words, sizeof v1);
+	memcpy(v2, digest2.words, sizeof v2);
+
+	return ((v1[0] ^ v2[0]) | (v1[1] ^ v2[1])) == 0;
+}
+
 bool challenge::whiterabbithole::compare_hashes(const std::string& hash1, const std::string& hash2)
 {
 	if (hash1.length() != hash2.length())
@@ -29,3 +309,242 @@ bool challenge::whiterabbithole::compare_hashes(const std::string& hash1, const
 
 	return true;
 }
+
+// --- DigestTable --- //
+
+// Ctors
+
+DigestTable::DigestTable(const std::vector<digest_t>& digests)
+{
+	// At most half full, so that probe sequences stay short
+	size_t capacity = 2;
+	while (capacity < 2 * digests.size()) capacity <<= 1;
+
+	this->slots = new Slot[capacity];
+	this->mask = capacity - 1;
+	this->count = digests.size();
+	for (size_t i = 0; i < capacity; i++)
+	{
+		this->slots[i].index = -1;
+	}
+
+	for (size_t i = 0; i < digests.size(); i++)
+	{
+		size_t position = digests[i].words[0] & this->mask;
+		while (this->slots[position].index >= 0 && !compare_digests(this->slots[position].digest, digests[i]))
+		{
+			position = (position + 1) & this->mask;
+		}
+
+		if (this->slots[position].index < 0)
+		{
+			this->slots[position].digest = digests[i];
+			this->slots[position].index = (int)i;
+		}
+	}
+}
+
+DigestTable::DigestTable(const DigestTable& other)
+{
+	this->mask = other.mask;
+	this->count = other.count;
+	this->slots = new Slot[this->mask + 1];
+	memcpy(this->slots, other.slots, (this->mask + 1) * sizeof(Slot));
+}
+
+DigestTable::~DigestTable()
+{
+	delete[] this->slots;
+}
+
+// Public methods
+
+size_t DigestTable::size() const
+{
+	return this->count;
+}
+
+int DigestTable::find(const digest_t& digest) const
+{
+	size_t position = digest.words[0] & this->mask;
+	while (this->slots[position].index >= 0)
+	{
+		if (compare_digests(this->slots[position].digest, digest))
+		{
+			return this->slots[position].index;
+		}
+		position = (position + 1) & this->mask;
+	}
+
+	return -1;
+}
+
+// --- HashVerifier --- //
+
+// Ctors
+
+HashVerifier::HashVerifier(const digest_t& target, size_t message_length)
+	: targets(std::vector<digest_t>(1, target))
+{
+	this->message_length = message_length;
+	this->use_early_check = message_length < md5_single_block_limit;
+	this->initialize_early_check(target);
+}
+
+HashVerifier::HashVerifier(const std::vector<digest_t>& targets, size_t message_length)
+	: targets(targets)
+{
+	this->message_length = message_length;
+	// One early check per target would not keep the cost flat
+	this->use_early_check = message_length < md5_single_block_limit && targets.size() == 1;
+	this->initialize_early_check(targets.empty() ? digest_t() : targets[0]);
+}
+
+// Public methods
+
+bool HashVerifier::is_early_check_enabled() const
+{
+	return this->use_early_check;
+}
+
+size_t HashVerifier::get_target_count() const
+{
+	return this->targets.size();
+}
+
+int HashVerifier::match(const char* message) const
+{
+	if (this->use_early_check &&
+		md5_early_check_scalar(&message, &(this->message_length), this->early_check) == 0)
+	{
+		return -1;
+	}
+
+	return this->targets.find(get_hash_digest(message, this->message_length));
+}
+
+size_t HashVerifier::match(const char* const* messages, size_t count, int* targets) const
+{
+	size_t matches_count = 0;
+	if (!this->use_early_check)
+	{
+		// Digests are computed in chunks by the batch kernels, then looked up
+		const size_t chunk_size = 64;
+		digest_t digests[chunk_size];
+		size_t lengths[chunk_size];
+		for (size_t i = 0; i < chunk_size; i++)
+		{
+			lengths[i] = this->message_length;
+		}
+
+		for (size_t i = 0; i < count; i += chunk_size)
+		{
+			size_t used = count - i < chunk_size ? count - i : chunk_size;
+			get_hashes(messages + i, lengths, used, digests);
+			for (size_t j = 0; j < used; j++)
+			{
+				targets[i + j] = this->targets.find(digests[j]);
+				if (targets[i + j] >= 0) matches_count++;
+			}
+		}
+		return matches_count;
+	}
+
+	const Md5Kernel& kernel = get_md5_kernel();
+	const char* lane_messages[16];
+	size_t lane_lengths[16];
+	for (size_t lane = 0; lane < kernel.lanes; lane++)
+	{
+		lane_lengths[lane] = this->message_length;
+	}
+
+	for (size_t i = 0; i < count; i += kernel.lanes)
+	{
+		size_t used = count - i < kernel.lanes ? count - i : kernel.lanes;
+		for (size_t lane = 0; lane < kernel.lanes; lane++)
+		{
+			// Idle lanes repeat the first message
+			lane_messages[lane] = messages[lane < used ? i + lane : i];
+		}
+
+		uint32_t mask = kernel.early_check(lane_messages, lane_lengths, this->early_check);
+		for (size_t lane = 0; lane < used; lane++)
+		{
+			// Lanes passing the check are hashed to the end
+			targets[i + lane] = (mask & (1u << lane)) != 0 ?
+				this->targets.find(get_hash_digest(lane_messages[lane], this->message_length)) : -1;
+			if (targets[i + lane] >= 0) matches_count++;
+		}
+	}
+
+	return matches_count;
+}
+
+// The lanes of the kernel read their words in place, those passing the early check are hashed
+// to the end one by one
+size_t HashVerifier::match_words(const uint32_t* words, size_t stride, size_t count, int* targets) const
+{
+	const Md5Kernel& kernel = get_md5_kernel();
+	size_t matches_count = 0;
+	digest_t digests[md5_max_lanes];
+	for (size_t i = 0; i < count; i += kernel.lanes)
+	{
+		size_t used = count - i < kernel.lanes ? count - i : kernel.lanes;
+		if (!this->use_early_check)
+		{
+			kernel.hash_words(words + i, stride, digests);
+			for (size_t lane = 0; lane < used; lane++)
+			{
+				targets[i + lane] = this->targets.find(digests[lane]);
+				if (targets[i + lane] >= 0) matches_count++;
+			}
+			continue;
+		}
+
+		uint32_t mask = kernel.early_check_words(words + i, stride, this->early_check);
+		for (size_t lane = 0; lane < used; lane++)
+		{
+			targets[i + lane] = -1;
+			if ((mask & (1u << lane)) == 0) continue;
+
+			md5_hash_words_scalar(words + i + lane, stride, digests);
+			targets[i + lane] = this->targets.find(digests[0]);
+			if (targets[i + lane] >= 0) matches_count++;
+		}
+	}
+
+	return matches_count;
+}
+
+// Private methods
+
+void HashVerifier::initialize_early_check(const digest_t& target)
+{
+	this->early_check.step = 60;
+	this->early_check.value = 0;
+
+	if (!this->use_early_check)
+	{
+		return;
+	}
+
+	// Registers after step 64, before the feed-forward addition
+	uint32_t a = target.words[0] - md5_init_a;
+	uint32_t b = target.words[1] - md5_init_b;
+	uint32_t c = target.words[2] - md5_init_c;
+	uint32_t d = target.words[3] - md5_init_d;
+
+	// Step 64 computed b = c + rotl(b60 + I(c, d, a) + x[9] + K64, 21), so b60 + x[9] is known
+	uint32_t b60_x9 = rotate_right(b - c, 21) - ScalarLanes::i(c, d, a) - 0xeb86d391;
+	this->early_check.step = 60;
+	this->early_check.value = b60_x9;
+
+	// When the message ends before word 9, x[9] is zero: b60 itself is known and step 63,
+	// c = d + rotl(c59 + I(d, a, b60) + x[2] + K63, 15), can be undone as well
+	if (this->message_length < 36)
+	{
+		uint32_t b60 = b60_x9;
+		this->early_check.step = 59;
+		this->early_check.value = rotate_right(c - d, 15) - ScalarLanes::i(d, a, b60) - 0x2ad7d2bb;
+	}
+}
@@ -3,11 +3,44 @@
 #ifndef HASHING_H_
 #define HASHING_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace challenge {
 	namespace whiterabbithole {
 
+		/// <summary>
+		/// Represents a binary MD5 digest as the four 32-bit words of the final MD5 state
+		/// (the digest bytes are the little-endian encoding of the words).
+		/// </summary>
+		struct digest_t {
+		public:
+			uint32_t words[4];
+		};
+
+		/// <summary>
+		/// Messages shorter than this (in bytes) fit, with padding, in a single MD5 block.
+		/// </summary>
+		const size_t md5_single_block_limit = 56;
+
+		/// <summary>
+		/// The most messages a batch kernel hashes at once.
+		/// </summary>
+		const size_t md5_max_lanes = 16;
+
+		/// <summary>
+		/// Describes the early check of a message against a target digest: a message can only
+		/// match if, after MD5 step 59 (resp. 60), register c plus message word 2 (resp. b plus
+		/// message word 9) equals the value.
+		/// </summary>
+		struct md5_early_check_t {
+		public:
+			unsigned int step;
+			uint32_t value;
+		};
+
 		/// <summary>
 		/// Computes the hash of a string.
 		/// </summary>
@@ -15,6 +48,209 @@ namespace challenge {
 		/// <returns>The MD5 hash (string representation).</returns>
 		std::string get_hash(const std::string& str);
 
+		/// <summary>
+		/// Computes the binary hash of a message.
+		/// </summary>
+		/// <param name="message">The message.</param>
+		/// <param name="length">The length of the message.</param>
+		/// <returns>The MD5 digest.</returns>
+		digest_t get_hash_digest(const char* message, size_t length);
+
+		/// <summary>
+		/// Computes the binary hash of a string.
+		/// </summary>
+		/// <param name="str">The input string.</param>
+		/// <returns>The MD5 digest.</returns>
+		digest_t get_hash_digest(const std::string& str);
+
+		/// <summary>
+		/// Computes the binary hashes of a batch of messages.
+		/// Single-block messages are hashed several at a time by the widest SIMD kernel
+		/// available on the CPU, the others by the scalar implementation.
+		/// </summary>
+		/// <param name="messages">The messages.</param>
+		/// <param name="lengths">The length of each message.</param>
+		/// <param name="count">The number of messages.</param>
+		/// <param name="digests">The output digests, one per message.</param>
+		void get_hashes(const char* const* messages, const size_t* lengths, size_t count, digest_t* digests);
+
+		/// <summary>
+		/// Computes the binary hashes of a batch of strings.
+		/// </summary>
+		/// <param name="messages">The input strings.</param>
+		/// <returns>The MD5 digests, one per string.</returns>
+		std::vector<digest_t> get_hashes(const std::vector<std::string>& messages);
+
+		/// <summary>
+		/// Initializes the MD5 block of the single-block messages of a length: the padding and the
+		/// length are written once, the bytes of every message are then written over the first
+		/// length bytes (the block bytes are the little-endian encoding of its words).
+		/// </summary>
+		/// <param name="length">The length of the messages, less than md5_single_block_limit.</param>
+		/// <param name="block">The 16 words of the block.</param>
+		void initialize_hash_block(size_t length, uint32_t block[16]);
+
+		/// <summary>
+		/// Gets the name of the MD5 kernel used for batches on this CPU.
+		/// </summary>
+		/// <returns>The kernel name (fx: avx2).</returns>
+		const char* get_hash_kernel_name();
+
+		/// <summary>
+		/// Gets the number of messages the batch kernel hashes at once on this CPU.
+		/// </summary>
+		/// <returns>The number of lanes of the kernel.</returns>
+		size_t get_hash_kernel_lanes();
+
+		/// <summary>
+		/// Gets the string representation of a binary digest.
+		/// </summary>
+		/// <param name="digest">The digest.</param>
+		/// <returns>The MD5 hash (string representation).</returns>
+		std::string digest_to_string(const digest_t& digest);
+
+		/// <summary>
+		/// Parses the string representation of a hash (32 hex digits, any case).
+		/// </summary>
+		/// <param name="hash">The MD5 hash (string representation).</param>
+		/// <param name="digest">The parsed digest.</param>
+		/// <returns>A value indicating whether the hash is well formed.</returns>
+		bool parse_hash(const std::string& hash, digest_t* digest);
+
+		/// <summary>
+		/// Compares two binary hashes.
+		/// </summary>
+		/// <param name="digest1">The first digest.</param>
+		/// <param name="digest2">The second digest.</param>
+		/// <returns>A value indicating whether the digests are the same or not.</returns>
+		bool compare_digests(const digest_t& digest1, const digest_t& digest2);
+
+		/// <summary>
+		/// Set of digests looked up in constant time: an open-addressing table (linear probing,
+		/// at most half full) indexed by the first digest word, which is uniformly distributed.
+		/// </summary>
+		class DigestTable
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="digests">The digests, identified by their position.</param>
+			DigestTable(const std::vector<digest_t>& digests);
+
+			/// <summary>
+			/// Copy initializes a new instance of this class.
+			/// </summary>
+			/// <param name="other">The other instance to copy from.</param>
+			DigestTable(const DigestTable& other);
+
+			/// <summary>
+			/// Destroys an instance of this class.
+			/// </summary>
+			~DigestTable();
+
+		private:
+			struct Slot {
+				digest_t digest;
+				int index; // -1 when free
+			};
+
+		private:
+			Slot* slots;
+			size_t mask;
+			size_t count;
+
+		public:
+			/// <summary>
+			/// Gets the number of digests.
+			/// </summary>
+			size_t size() const;
+
+			/// <summary>
+			/// Looks up a digest.
+			/// </summary>
+			/// <param name="digest">The digest to find.</param>
+			/// <returns>The position of the digest in the initial set (the first one if repeated), -1 if absent.</returns>
+			int find(const digest_t& digest) const;
+
+		private:
+			DigestTable& operator=(const DigestTable& other);
+		}; // class DigestTable
+
+		/// <summary>
+		/// Verifies messages of a fixed length against a set of target digests.
+		/// With one target, the last MD5 steps are undone on it once, so that for single-block
+		/// messages a mismatch is detected after 59 (or 60) of the 64 steps with one 32-bit
+		/// compare; only messages passing that check are hashed to the end. With more targets,
+		/// every digest is looked up in a DigestTable, so the cost does not grow with them.
+		/// </summary>
+		class HashVerifier
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="target">The target digest.</param>
+			/// <param name="message_length">The length of every message to verify.</param>
+			HashVerifier(const digest_t& target, size_t message_length);
+
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="targets">The target digests.</param>
+			/// <param name="message_length">The length of every message to verify.</param>
+			HashVerifier(const std::vector<digest_t>& targets, size_t message_length);
+
+		private:
+			DigestTable targets;
+			size_t message_length;
+			bool use_early_check;
+			md5_early_check_t early_check;
+
+		public:
+			/// <summary>
+			/// Gets a value indicating whether messages are checked before the last MD5 steps
+			/// (only possible for single-block messages and a single target).
+			/// </summary>
+			bool is_early_check_enabled() const;
+
+			/// <summary>
+			/// Gets the number of targets.
+			/// </summary>
+			size_t get_target_count() const;
+
+			/// <summary>
+			/// Matches a message against the targets.
+			/// </summary>
+			/// <param name="message">The message, of the verifier's length.</param>
+			/// <returns>The index of the target the message hashes to, -1 if none.</returns>
+			int match(const char* message) const;
+
+			/// <summary>
+			/// Matches a batch of messages against the targets, several at a time with the SIMD kernels.
+			/// </summary>
+			/// <param name="messages">The messages, all of the verifier's length.</param>
+			/// <param name="count">The number of messages.</param>
+			/// <param name="targets">The output, per message the index of the matched target or -1.</param>
+			/// <returns>The number of messages hashing to a target.</returns>
+			size_t match(const char* const* messages, size_t count, int* targets) const;
+
+			/// <summary>
+			/// Matches a batch of single-block messages given as their MD5 blocks (see
+			/// initialize_hash_block), laid out word by word: word k of message i is words[k * stride + i],
+			/// so that the kernels load a word of all their lanes at once, with no padding nor copy.
+			/// </summary>
+			/// <param name="words">The words of the blocks, the words past count up to the stride are read but ignored.</param>
+			/// <param name="stride">The distance between two words of a message, a multiple of md5_max_lanes.</param>
+			/// <param name="count">The number of messages, at most the stride.</param>
+			/// <param name="targets">The output, per message the index of the matched target or -1.</param>
+			/// <returns>The number of messages hashing to a target.</returns>
+			size_t match_words(const uint32_t* words, size_t stride, size_t count, int* targets) const;
+
+		private:
+			void initialize_early_check(const digest_t& target);
+		}; // class HashVerifier
+
 		/// <summary>
 		/// Compares two hashes.
 		/// </summary>
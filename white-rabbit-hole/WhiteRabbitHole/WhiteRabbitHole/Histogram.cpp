@@ -1,131 +1,188 @@
 // Histogram.cpp
 
+#include <cstring>
+
 #include "Histogram.h"
 
+// SSE2 is part of the x64 baseline, other targets use the scalar loops
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HISTOGRAM_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace challenge::whiterabbithole;
 
 // Ctors
 
+Histogram::Histogram()
+{
+	memset(this->counts, 0, sizeof this->counts);
+}
+
 Histogram::Histogram(const std::string& phrase)
 {
-	this->phrase = phrase;
-	this->char_histo = 0;
+	this->initialize(phrase.c_str(), phrase.length());
+}
 
-	this->initialize();
+Histogram::Histogram(const char* str, size_t length)
+{
+	this->initialize(str, length);
 }
 
 Histogram::Histogram(const Histogram& other)
 {
-	this->phrase = other.phrase;
-
-	this->char_histo = new histo_t();
-	*(this->char_histo) = *(other.char_histo);
-
-	this->initialize();
+	memcpy(this->counts, other.counts, sizeof this->counts);
 }
 
 Histogram::~Histogram()
 {
-	if (this->char_histo)
-	{
-		this->char_histo->clear();
-		delete this->char_histo;
-	}
 }
 
 // Public methods
 
 bool Histogram::equals(const Histogram& histogram1, const Histogram& histogram2)
 {
-	return eval_from_to(histogram1, histogram2, eval_equal, true) &&
-		eval_from_to(histogram2, histogram1, eval_equal, true);
+#ifdef HISTOGRAM_USE_SSE2
+	__m128i diff = _mm_setzero_si128();
+	for (size_t i = 0; i < symbols_count; i += 16)
+	{
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(histogram1.counts + i));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(histogram2.counts + i));
+		diff = _mm_or_si128(diff, _mm_xor_si128(v1, v2));
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xFFFF;
+#else
+	return memcmp(histogram1.counts, histogram2.counts, sizeof histogram1.counts) == 0;
+#endif
 }
 
 bool Histogram::contains(const Histogram& histogram1, const Histogram& histogram2)
 {
-	return eval_from_to(histogram1, histogram2, eval_geq, false) &&
-		eval_from_to(histogram2, histogram1, eval_leq, false);
+#ifdef HISTOGRAM_USE_SSE2
+	// histogram1 >= histogram2 on every symbol <=> max(histogram1, histogram2) == histogram1
+	__m128i diff = _mm_setzero_si128();
+	for (size_t i = 0; i < symbols_count; i += 16)
+	{
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(histogram1.counts + i));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(histogram2.counts + i));
+		diff = _mm_or_si128(diff, _mm_xor_si128(_mm_max_epu8(v1, v2), v1));
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xFFFF;
+#else
+	for (size_t i = 0; i < symbols_count; i++)
+	{
+		if (histogram1.counts[i] < histogram2.counts[i])
+		{
+			return false;
+		}
+	}
+	return true;
+#endif
 }
 
-bool Histogram::operator==(const Histogram& other) const
+size_t Histogram::get_count(char symbol) const
 {
-	return equals(*this, other);
+	return this->counts[(unsigned char)symbol];
 }
 
-bool Histogram::operator!=(const Histogram& other) const
+bool Histogram::is_saturated() const
 {
-	return !equals(*this, other);
+#ifdef HISTOGRAM_USE_SSE2
+	__m128i saturated = _mm_setzero_si128();
+	for (size_t i = 0; i < symbols_count; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(this->counts + i));
+		saturated = _mm_or_si128(saturated, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)max_count)));
+	}
+	return _mm_movemask_epi8(saturated) != 0;
+#else
+	for (size_t i = 0; i < symbols_count; i++)
+	{
+		if (this->counts[i] == max_count)
+		{
+			return true;
+		}
+	}
+	return false;
+#endif
 }
 
-bool Histogram::operator>=(const Histogram& other) const
+Histogram& Histogram::operator=(const Histogram& other)
 {
-	return contains(*this, other);
+	memcpy(this->counts, other.counts, sizeof this->counts);
+	return *this;
 }
 
-bool Histogram::operator<=(const Histogram& other) const
+Histogram& Histogram::operator+=(const Histogram& other)
 {
-	return contains(other, *this);
+#ifdef HISTOGRAM_USE_SSE2
+	for (size_t i = 0; i < symbols_count; i += 16)
+	{
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(this->counts + i));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(other.counts + i));
+		_mm_storeu_si128((__m128i*)(this->counts + i), _mm_adds_epu8(v1, v2));
+	}
+#else
+	for (size_t i = 0; i < symbols_count; i++)
+	{
+		size_t count = (size_t)this->counts[i] + other.counts[i];
+		this->counts[i] = (uint8_t)(count < max_count ? count : max_count);
+	}
+#endif
+	return *this;
 }
 
-// Private methods
-
-// At construction time we generate the histo data structure
-void Histogram::initialize()
+Histogram& Histogram::operator-=(const Histogram& other)
 {
-	if (this->char_histo)
+#ifdef HISTOGRAM_USE_SSE2
+	for (size_t i = 0; i < symbols_count; i += 16)
 	{
-		this->char_histo->clear();
-		delete this->char_histo;
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(this->counts + i));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(other.counts + i));
+		_mm_storeu_si128((__m128i*)(this->counts + i), _mm_sub_epi8(v1, v2));
 	}
-	this->char_histo = new histo_t();
-
-	for (size_t i = 0, l = this->phrase.length(); i < l; i++)
+#else
+	for (size_t i = 0; i < symbols_count; i++)
 	{
-		char char_at = this->phrase.at(i);
-		if (this->char_histo->find(char_at) == this->char_histo->end())
-		{
-			(*(this->char_histo))[char_at] = 0;
-		}
-		(*(this->char_histo))[char_at] = (*(this->char_histo))[char_at] + 1;
+		this->counts[i] -= other.counts[i];
 	}
+#endif
+	return *this;
 }
 
-bool Histogram::eval_from_to(const Histogram& histogram1, const Histogram& histogram2,
-	bool (*eval)(size_t v1, size_t v2), bool exact_alphabet)
+bool Histogram::operator==(const Histogram& other) const
 {
-	for (histo_t::const_iterator it = histogram1.char_histo->begin(); it != histogram1.char_histo->end(); it++)
-	{
-		char char_at_1 = it->first;
-		size_t level_at_1 = it->second;
-
-		histo_t::const_iterator at_2 = histogram2.char_histo->find(char_at_1);
-		if (at_2 == histogram2.char_histo->end())
-		{
-			if (exact_alphabet) return false;
-			continue;
-		}
-		size_t level_at_2 = at_2->second;
-		bool eval_res = eval(level_at_1, level_at_2);
-		if (!eval_res)
-		{
-			return false;
-		}
-	}
+	return equals(*this, other);
+}
 
-	return true;
+bool Histogram::operator!=(const Histogram& other) const
+{
+	return !equals(*this, other);
 }
 
-bool Histogram::eval_equal(size_t v1, size_t v2)
+bool Histogram::operator>=(const Histogram& other) const
 {
-	return v1 == v2;
+	return contains(*this, other);
 }
 
-bool Histogram::eval_geq(size_t v1, size_t v2)
+bool Histogram::operator<=(const Histogram& other) const
 {
-	return v1 >= v2;
+	return contains(other, *this);
 }
 
-bool Histogram::eval_leq(size_t v1, size_t v2)
+// Private methods
+
+// At construction time we fill the counts
+void Histogram::initialize(const char* str, size_t length)
 {
-	return v1 <= v2;
+	memset(this->counts, 0, sizeof this->counts);
+
+	for (size_t i = 0; i < length; i++)
+	{
+		uint8_t& count = this->counts[(unsigned char)str[i]];
+		if (count < max_count)
+		{
+			count++;
+		}
+	}
 }
@@ -4,7 +4,7 @@
 #define HISTOGRAM_H_
 
 #include <string>
-#include <map>
+#include <cstdint>
 
 #include "Common.h"
 
@@ -13,20 +13,32 @@ namespace challenge {
 
 		/// <summary>
 		/// Describes an histogram for strings.
+		/// Counts are stored inline in a flat array indexed by symbol (no allocation), each
+		/// count saturates at max_count occurrences.
 		/// </summary>
 		class Histogram
 		{
-		private:
-			typedef std::map<char, size_t> histo_t;
+		public:
+			/// <summary>
+			/// The number of symbols an histogram can count.
+			/// </summary>
+			static const size_t symbols_count = 256;
+
+			/// <summary>
+			/// The count a symbol saturates at: a count of max_count stands for max_count
+			/// occurrences or more.
+			/// </summary>
+			static const size_t max_count = 255;
 
 		public:
+			Histogram();
 			Histogram(const std::string& phrase);
+			Histogram(const char* str, size_t length);
 			Histogram(const Histogram& other);
 			~Histogram();
 
 		private:
-			std::string phrase;
-			histo_t* char_histo;
+			uint8_t counts[symbols_count];
 
 		public:
 			/// <summary>
@@ -49,6 +61,42 @@ namespace challenge {
 			/// </returns>
 			static bool contains(const Histogram& histogram1, const Histogram& histogram2);
 
+			/// <summary>
+			/// Gets the number of occurrences of a symbol.
+			/// </summary>
+			/// <param name="symbol">The symbol.</param>
+			/// <returns>The count of the symbol.</returns>
+			size_t get_count(char symbol) const;
+
+			/// <summary>
+			/// Gets a value indicating whether a count saturated, i.e. whether the counts
+			/// may be lower than the actual occurrences.
+			/// </summary>
+			/// <returns>True if a symbol is counted max_count times, false otherwise.</returns>
+			bool is_saturated() const;
+
+			/// <summary>
+			/// Assigns another histogram to this one.
+			/// </summary>
+			/// <param name="other">The other histogram.</param>
+			/// <returns>This histogram.</returns>
+			Histogram& operator=(const Histogram& other);
+
+			/// <summary>
+			/// Adds the counts of another histogram to this one, saturating at max_count.
+			/// </summary>
+			/// <param name="other">The other histogram.</param>
+			/// <returns>This histogram.</returns>
+			Histogram& operator+=(const Histogram& other);
+
+			/// <summary>
+			/// Subtracts the counts of another histogram from this one.
+			/// This histogram must contain the other one.
+			/// </summary>
+			/// <param name="other">The other histogram.</param>
+			/// <returns>This histogram.</returns>
+			Histogram& operator-=(const Histogram& other);
+
 			/// <summary>
 			/// Compares two histograms for equality.
 			/// </summary>
@@ -78,12 +126,7 @@ namespace challenge {
 			bool operator<=(const Histogram& other) const;
 
 		private:
-			void initialize();
-			static bool eval_from_to(const Histogram& histogram1, const Histogram& histogram2,
-				bool (*eval)(size_t v1, size_t v2), bool exact_alphabet);
-			static bool eval_equal(size_t v1, size_t v2);
-			static bool eval_geq(size_t v1, size_t v2);
-			static bool eval_leq(size_t v1, size_t v2);
+			void initialize(const char* str, size_t length);
 		};
 
 	} // namespace whiterabbithole
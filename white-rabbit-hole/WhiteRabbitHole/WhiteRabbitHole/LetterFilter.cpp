@@ -0,0 +1,141 @@
+// LetterFilter.cpp
+
+#include <cstring>
+
+#include "LetterFilter.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+using namespace challenge::whiterabbithole;
+
+static inline unsigned int count_trailing_zeros(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (unsigned int)index;
+#elif defined(__GNUC__)
+	return (unsigned int)__builtin_ctzll(x);
+#else
+	unsigned int index = 0;
+	while (!(x & 1))
+	{
+		x >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+// Ctors
+
+LetterFilter::LetterFilter(const std::string& letters)
+{
+	memset(this->bitmap, 0, sizeof this->bitmap);
+
+	for (std::string::const_iterator it = letters.begin(); it != letters.end(); it++)
+	{
+		unsigned char symbol = (unsigned char)*it;
+		this->bitmap[(symbol >> 7) * 16 + (symbol & 15)] |= (uint8_t)(1 << ((symbol >> 4) & 7));
+	}
+}
+
+LetterFilter::LetterFilter(const LetterFilter& other)
+{
+	memcpy(this->bitmap, other.bitmap, sizeof this->bitmap);
+}
+
+// Public methods
+
+bool LetterFilter::accept(const char* word, size_t length) const
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		if (!this->accept_symbol((unsigned char)word[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t LetterFilter::scan_lines(const char* data, size_t size, std::vector<word_view_t>* words) const
+{
+	size_t line_count = 0;
+	size_t line_start = 0;
+	bool line_rejected = false;
+	size_t pos = 0;
+
+	// Emits the line [line_start, end) and starts the next one
+	auto end_line = [&](size_t end) {
+		if (end > line_start)
+		{
+			line_count++;
+			if (!line_rejected)
+			{
+				word_view_t word = { line_start, end - line_start };
+				words->push_back(word);
+			}
+		}
+		line_start = end + 1;
+		line_rejected = false;
+	};
+
+#ifdef WHITERABBITHOLE_X86
+	if (get_cpu_features().avx2)
+	{
+		for (; pos + 64 <= size; pos += 64)
+		{
+			uint64_t allowed, newlines;
+			letter_filter_masks_avx2(data + pos, this->bitmap, &allowed, &newlines);
+			uint64_t rejected = ~(allowed | newlines);
+
+			// Every newline closes a line, rejected if any byte before it in the block is
+			while (newlines)
+			{
+				unsigned int bit = count_trailing_zeros(newlines);
+				uint64_t before = (((uint64_t)1) << bit) - 1;
+				if (rejected & before)
+				{
+					line_rejected = true;
+				}
+				end_line(pos + bit);
+				rejected &= ~before;
+				newlines &= newlines - 1;
+			}
+
+			if (rejected)
+			{
+				line_rejected = true;
+			}
+		}
+	}
+#endif
+
+	// Tail of the buffer (or all of it without SIMD)
+	for (; pos < size; pos++)
+	{
+		if (data[pos] == '\n')
+		{
+			end_line(pos);
+		}
+		else if (!this->accept_symbol((unsigned char)data[pos]))
+		{
+			line_rejected = true;
+		}
+	}
+
+	// Last line might not be terminated
+	end_line(size);
+
+	return line_count;
+}
+
+// Private methods
+
+bool LetterFilter::accept_symbol(unsigned char symbol) const
+{
+	return (this->bitmap[(symbol >> 7) * 16 + (symbol & 15)] >> ((symbol >> 4) & 7)) & 1;
+}
@@ -0,0 +1,86 @@
+// LetterFilter.h
+
+#ifndef LETTERFILTER_H_
+#define LETTERFILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Cpu.h"
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Describes a word as a range of a buffer it is not copied out of.
+		/// </summary>
+		struct word_view_t {
+		public:
+			size_t offset;
+			size_t length;
+		};
+
+		/// <summary>
+		/// Accepts the words made only of a given set of characters.
+		/// The set is a 256-bit bitmap laid out for nibble lookups: the bit of symbol c is
+		/// bit (c >> 4) & 7 of byte (c >> 7) * 16 + (c & 15), which lets the SIMD kernels test
+		/// 32 bytes at once with two table shuffles.
+		/// </summary>
+		class LetterFilter
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="letters">The allowed characters (fx: the anagram phrase).</param>
+			LetterFilter(const std::string& letters);
+
+			/// <summary>
+			/// Copy initializes a new instance of this class.
+			/// </summary>
+			/// <param name="other">The other instance to copy from.</param>
+			LetterFilter(const LetterFilter& other);
+
+		private:
+			uint8_t bitmap[32];
+
+		public:
+			/// <summary>
+			/// Checks whether a word is only made of allowed characters.
+			/// </summary>
+			/// <param name="word">The word.</param>
+			/// <param name="length">The length of the word.</param>
+			/// <returns>A value indicating whether the word is accepted.</returns>
+			bool accept(const char* word, size_t length) const;
+
+			/// <summary>
+			/// Splits a buffer in newline separated words and keeps the accepted ones.
+			/// The whole buffer is classified by the widest SIMD kernel available, words are
+			/// never copied. Empty lines are skipped.
+			/// </summary>
+			/// <param name="data">The buffer (fx: a mapped vocabulary file).</param>
+			/// <param name="size">The size of the buffer.</param>
+			/// <param name="words">The accepted words, in buffer order.</param>
+			/// <returns>The number of non empty lines in the buffer.</returns>
+			size_t scan_lines(const char* data, size_t size, std::vector<word_view_t>* words) const;
+
+		private:
+			bool accept_symbol(unsigned char symbol) const;
+		}; // class LetterFilter
+
+#ifdef WHITERABBITHOLE_X86
+		/// <summary>
+		/// Classifies 64 bytes with AVX2: sets bit i of allowed when byte i is in the bitmap
+		/// and bit i of newlines when byte i is a newline.
+		/// Only call when get_cpu_features() reports AVX2.
+		/// </summary>
+		void letter_filter_masks_avx2(const char* block, const uint8_t* bitmap,
+			uint64_t* allowed, uint64_t* newlines);
+#endif
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
@@ -0,0 +1,44 @@
+// LetterFilterAvx2.cpp
+
+#include "LetterFilter.h"
+
+#ifdef WHITERABBITHOLE_X86
+
+#include <immintrin.h>
+
+void challenge::whiterabbithole::letter_filter_masks_avx2(const char* block, const uint8_t* bitmap,
+	uint64_t* allowed, uint64_t* newlines)
+{
+	// Rows of the bitmap for symbols 0x00-0x7F and 0x80-0xFF, indexed by the low nibble
+	const __m256i rows_low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)bitmap));
+	const __m256i rows_high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(bitmap + 16)));
+	// Bit of the row to test, indexed by the high nibble
+	const __m256i bits = _mm256_setr_epi8(
+		1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128,
+		1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	const __m256i newline = _mm256_set1_epi8('\n');
+
+	uint64_t allowed_mask = 0;
+	uint64_t newlines_mask = 0;
+	for (int half = 0; half < 2; half++)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(block + 32 * half));
+		__m256i low = _mm256_and_si256(v, nibble);
+		__m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+
+		// The sign bit of each byte picks the table
+		__m256i row = _mm256_blendv_epi8(
+			_mm256_shuffle_epi8(rows_low, low), _mm256_shuffle_epi8(rows_high, low), v);
+		__m256i bit = _mm256_shuffle_epi8(bits, high);
+		__m256i in_set = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit);
+
+		allowed_mask |= ((uint64_t)(uint32_t)_mm256_movemask_epi8(in_set)) << (32 * half);
+		newlines_mask |= ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline))) << (32 * half);
+	}
+
+	*allowed = allowed_mask;
+	*newlines = newlines_mask;
+}
+
+#endif
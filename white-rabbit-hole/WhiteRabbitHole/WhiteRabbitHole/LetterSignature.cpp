@@ -0,0 +1,131 @@
+// LetterSignature.cpp
+
+#include <cstring>
+
+#include "LetterSignature.h"
+
+using namespace challenge::whiterabbithole;
+
+// Word of the symbols out of the phrase
+static const uint8_t no_lane = 0xFF;
+
+// Ctors
+
+LetterSignatureLayout::LetterSignatureLayout(const std::string& phrase)
+{
+	memset(this->lane_words, no_lane, sizeof this->lane_words);
+	memset(this->lane_shifts, 0, sizeof this->lane_shifts);
+	memset(this->lane_symbols, 0, sizeof this->lane_symbols);
+	this->lanes_count = 0;
+	this->guards[0] = 0;
+	this->guards[1] = 0;
+	this->count_mask = 0;
+	this->packable = false;
+	this->phrase_signature.words[0] = this->phrase_signature.words[1] = 0;
+	this->letters_signature.words[0] = this->letters_signature.words[1] = 0;
+
+	// Lanes are as wide as the highest count needs, plus the guard
+	size_t counts[256] = { 0 };
+	size_t symbols_count = 0;
+	size_t max_count = 0;
+	for (std::string::const_iterator it = phrase.begin(); it != phrase.end(); it++)
+	{
+		size_t& count = counts[(unsigned char)*it];
+		if (count++ == 0) symbols_count++;
+		if (count > max_count) max_count = count;
+	}
+
+	unsigned int count_bits = 1;
+	while (((size_t)1 << count_bits) <= max_count) count_bits++;
+	unsigned int lane_bits = count_bits + 1;
+	unsigned int lanes_per_word = 64 / lane_bits;
+	if (symbols_count > 2 * lanes_per_word)
+	{
+		return;
+	}
+
+	unsigned int lane = 0;
+	for (unsigned int symbol = 0; symbol < 256; symbol++)
+	{
+		if (counts[symbol] == 0) continue;
+		unsigned int word = lane / lanes_per_word;
+		unsigned int shift = (lane % lanes_per_word) * lane_bits;
+		this->lane_words[symbol] = (uint8_t)word;
+		this->lane_shifts[symbol] = (uint8_t)shift;
+		this->lane_symbols[lane] = (uint8_t)symbol;
+		this->guards[word] |= (uint64_t)1 << (shift + count_bits);
+		lane++;
+	}
+	this->lanes_count = lane;
+	this->count_mask = ((uint64_t)1 << count_bits) - 1;
+	this->packable = true;
+
+	std::string letters;
+	for (std::string::const_iterator it = phrase.begin(); it != phrase.end(); it++)
+	{
+		if (*it != ' ') letters += *it;
+	}
+	this->get_signature(phrase.c_str(), phrase.length(), &this->phrase_signature);
+	this->get_signature(letters.c_str(), letters.length(), &this->letters_signature);
+}
+
+LetterSignatureLayout::LetterSignatureLayout(const LetterSignatureLayout& other)
+{
+	memcpy(this->lane_words, other.lane_words, sizeof this->lane_words);
+	memcpy(this->lane_shifts, other.lane_shifts, sizeof this->lane_shifts);
+	memcpy(this->lane_symbols, other.lane_symbols, sizeof this->lane_symbols);
+	this->lanes_count = other.lanes_count;
+	this->guards[0] = other.guards[0];
+	this->guards[1] = other.guards[1];
+	this->count_mask = other.count_mask;
+	this->packable = other.packable;
+	this->phrase_signature = other.phrase_signature;
+	this->letters_signature = other.letters_signature;
+}
+
+// Public methods
+
+bool LetterSignatureLayout::is_packable() const
+{
+	return this->packable;
+}
+
+const letter_signature_t& LetterSignatureLayout::get_phrase_signature() const
+{
+	return this->phrase_signature;
+}
+
+const letter_signature_t& LetterSignatureLayout::get_letters_signature() const
+{
+	return this->letters_signature;
+}
+
+// A count reaching the guard of its lane is over what the lane holds: the word is given up
+// before it carries into the next lane
+bool LetterSignatureLayout::get_signature(const char* word, size_t length, letter_signature_t* signature) const
+{
+	signature->words[0] = 0;
+	signature->words[1] = 0;
+	if (!this->packable)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < length; i++)
+	{
+		unsigned char symbol = (unsigned char)word[i];
+		uint8_t lane_word = this->lane_words[symbol];
+		if (lane_word == no_lane)
+		{
+			return false;
+		}
+
+		signature->words[lane_word] += (uint64_t)1 << this->lane_shifts[symbol];
+		if (signature->words[lane_word] & this->guards[lane_word])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
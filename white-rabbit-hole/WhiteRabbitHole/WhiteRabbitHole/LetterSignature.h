@@ -0,0 +1,200 @@
+// LetterSignature.h
+
+#ifndef LETTERSIGNATURE_H_
+#define LETTERSIGNATURE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Represents the letter counts of a word packed in two 64-bit words (see LetterSignatureLayout).
+		/// </summary>
+		struct letter_signature_t {
+		public:
+			uint64_t words[2];
+		};
+
+		/// <summary>
+		/// Packs letter counts over the alphabet of a phrase: every symbol of the phrase gets a lane
+		/// of a few count bits topped by a guard bit, lanes never straddle a word.
+		/// Counts are then compared and subtracted a word at a time (SWAR): setting the guards
+		/// before subtracting keeps borrows inside their lane, and a guard cleared by the
+		/// subtraction marks a lane that was overdrawn.
+		/// Count bits are just enough for the highest count of the phrase, so that larger counts
+		/// are known not to fit. A phrase whose lanes do not fit in two words is not packable.
+		/// </summary>
+		class LetterSignatureLayout
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="phrase">The phrase whose symbols are packed.</param>
+			LetterSignatureLayout(const std::string& phrase);
+
+			/// <summary>
+			/// Copy initializes a new instance of this class.
+			/// </summary>
+			/// <param name="other">The other instance to copy from.</param>
+			LetterSignatureLayout(const LetterSignatureLayout& other);
+
+		private:
+			// Word and shift of the lane of every symbol (word no_lane when not in the phrase)
+			uint8_t lane_words[256];
+			uint8_t lane_shifts[256];
+			// Symbols with a lane, in lane order
+			uint8_t lane_symbols[64];
+			size_t lanes_count;
+			uint64_t guards[2];
+			uint64_t count_mask; // Count bits of a lane, unshifted
+			bool packable;
+			letter_signature_t phrase_signature;
+			letter_signature_t letters_signature;
+
+		public:
+			/// <summary>
+			/// Gets a value indicating whether the phrase fits the layout, signatures are all empty otherwise.
+			/// </summary>
+			bool is_packable() const;
+
+			/// <summary>
+			/// Gets the signature of the phrase.
+			/// </summary>
+			const letter_signature_t& get_phrase_signature() const;
+
+			/// <summary>
+			/// Gets the signature of the letters of the phrase, without its spaces.
+			/// </summary>
+			const letter_signature_t& get_letters_signature() const;
+
+			/// <summary>
+			/// Computes the signature of a word.
+			/// </summary>
+			/// <param name="word">The word.</param>
+			/// <param name="length">The length of the word.</param>
+			/// <param name="signature">The signature.</param>
+			/// <returns>
+			/// A value indicating whether the word can be packed: false when it has a symbol out of
+			/// the phrase or more occurrences of a symbol than a lane holds (it cannot fit the phrase).
+			/// </returns>
+			bool get_signature(const char* word, size_t length, letter_signature_t* signature) const;
+
+			/// <summary>
+			/// Gets the number of occurrences of a symbol in a signature.
+			/// </summary>
+			/// <param name="signature">The signature.</param>
+			/// <param name="symbol">The symbol (0 when out of the phrase).</param>
+			inline size_t get_count(const letter_signature_t& signature, char symbol) const
+			{
+				uint8_t lane_word = this->lane_words[(unsigned char)symbol];
+				return lane_word > 1 ? 0 :
+					(size_t)((signature.words[lane_word] >> this->lane_shifts[(unsigned char)symbol]) & this->count_mask);
+			}
+
+			/// <summary>
+			/// Unpacks the counts of all symbols of the phrase in a signature.
+			/// </summary>
+			/// <param name="signature">The signature.</param>
+			/// <param name="counts">The count of every symbol (by unsigned value), the symbols out of the phrase are left as is.</param>
+			inline void get_counts(const letter_signature_t& signature, uint8_t* counts) const
+			{
+				for (size_t i = 0; i < this->lanes_count; i++)
+				{
+					uint8_t symbol = this->lane_symbols[i];
+					counts[symbol] = (uint8_t)((signature.words[this->lane_words[symbol]] >> this->lane_shifts[symbol]) &
+						this->count_mask);
+				}
+			}
+
+			/// <summary>
+			/// Checks whether a signature holds at least the counts of another one.
+			/// </summary>
+			/// <param name="signature1">The containing signature.</param>
+			/// <param name="signature2">The contained signature.</param>
+			inline bool contains(const letter_signature_t& signature1, const letter_signature_t& signature2) const
+			{
+				uint64_t borrows =
+					(~((signature1.words[0] | this->guards[0]) - signature2.words[0]) & this->guards[0]) |
+					(~((signature1.words[1] | this->guards[1]) - signature2.words[1]) & this->guards[1]);
+				return borrows == 0;
+			}
+
+			/// <summary>
+			/// Subtracts a signature from a residual one if the residual contains it.
+			/// </summary>
+			/// <param name="residual">The residual signature, left as is when it does not contain the other one.</param>
+			/// <param name="signature">The signature to subtract.</param>
+			/// <returns>A value indicating whether the signature was subtracted.</returns>
+			inline bool subtract(letter_signature_t* residual, const letter_signature_t& signature) const
+			{
+				uint64_t word0 = (residual->words[0] | this->guards[0]) - signature.words[0];
+				uint64_t word1 = (residual->words[1] | this->guards[1]) - signature.words[1];
+				if (((~word0 & this->guards[0]) | (~word1 & this->guards[1])) != 0)
+				{
+					return false;
+				}
+
+				residual->words[0] = word0 & ~this->guards[0];
+				residual->words[1] = word1 & ~this->guards[1];
+				return true;
+			}
+
+			/// <summary>
+			/// Adds back a signature subtracted from a residual one.
+			/// </summary>
+			/// <param name="residual">The residual signature.</param>
+			/// <param name="signature">The signature to add.</param>
+			static inline void add(letter_signature_t* residual, const letter_signature_t& signature)
+			{
+				residual->words[0] += signature.words[0];
+				residual->words[1] += signature.words[1];
+			}
+
+			/// <summary>
+			/// Compares two signatures.
+			/// </summary>
+			static inline bool equals(const letter_signature_t& signature1, const letter_signature_t& signature2)
+			{
+				return ((signature1.words[0] ^ signature2.words[0]) | (signature1.words[1] ^ signature2.words[1])) == 0;
+			}
+
+			/// <summary>
+			/// Checks whether a signature has no letters left.
+			/// </summary>
+			static inline bool is_empty(const letter_signature_t& signature)
+			{
+				return (signature.words[0] | signature.words[1]) == 0;
+			}
+		}; // class LetterSignatureLayout
+
+		/// <summary>
+		/// Hashes signatures, to key unordered containers with them.
+		/// </summary>
+		struct letter_signature_hash_t {
+		public:
+			inline size_t operator()(const letter_signature_t& signature) const
+			{
+				uint64_t hash = (signature.words[0] ^ (signature.words[1] * 0x9E3779B97F4A7C15ULL)) * 0xFF51AFD7ED558CCDULL;
+				return (size_t)(hash ^ (hash >> 32));
+			}
+		};
+
+		/// <summary>
+		/// Compares signatures, to key unordered containers with them.
+		/// </summary>
+		struct letter_signature_equal_t {
+		public:
+			inline bool operator()(const letter_signature_t& signature1, const letter_signature_t& signature2) const
+			{
+				return LetterSignatureLayout::equals(signature1, signature2);
+			}
+		};
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
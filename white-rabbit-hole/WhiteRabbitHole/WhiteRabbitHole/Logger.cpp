@@ -0,0 +1,111 @@
+// Logger.cpp
+
+#include <chrono>
+
+#include "Logger.h"
+
+using namespace challenge::whiterabbithole;
+
+// Records written before the stream is flushed during a long burst
+static const size_t max_unflushed_count = 1024;
+
+// Ctors
+
+Logger::Logger(std::ostream& stream, LogLevel level, size_t capacity)
+	: records(capacity)
+{
+	this->stream = &stream;
+	this->level = level;
+	this->pushed_count.store(0);
+	this->written_count.store(0);
+	this->stopping.store(false);
+	this->writer = std::thread(&Logger::run_writer, this);
+}
+
+Logger::~Logger()
+{
+	this->stopping.store(true);
+	this->writer.join();
+}
+
+// Public methods
+
+LogLevel Logger::get_level() const
+{
+	return this->level;
+}
+
+void Logger::write(std::string message)
+{
+	this->pushed_count.fetch_add(1);
+	this->records.push(message);
+}
+
+void Logger::flush()
+{
+	size_t pushed = this->pushed_count.load();
+	unsigned int attempt = 0;
+	while (this->written_count.load() < pushed)
+	{
+		BoundedQueue<std::string>::back_off(attempt++);
+	}
+}
+
+bool Logger::parse_level(const std::string& name, LogLevel* level)
+{
+	static const char* names[] = { "trace", "debug", "info", "warning", "error", "silent" };
+	for (int i = LogLevel::Trace; i <= LogLevel::Silent; i++)
+	{
+		if (name == names[i])
+		{
+			*level = (LogLevel)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Private methods
+
+// Records are written as they come and the stream is flushed once the buffer is empty: a burst
+// costs one flush (one per max_unflushed_count records when it does not end). An idle writer
+// sleeps, records wait at most a millisecond.
+void Logger::run_writer()
+{
+	std::string record;
+	size_t unflushed = 0;
+	unsigned int attempt = 0;
+	while (true)
+	{
+		// Once stopping, an empty buffer stays empty (writers are gone)
+		bool stopping = this->stopping.load();
+		if (this->records.try_pop(&record))
+		{
+			*(this->stream) << record << '\n';
+			attempt = 0;
+			if (++unflushed == max_unflushed_count)
+			{
+				this->stream->flush();
+				this->written_count.fetch_add(unflushed);
+				unflushed = 0;
+			}
+			continue;
+		}
+
+		if (unflushed > 0)
+		{
+			this->stream->flush();
+			this->written_count.fetch_add(unflushed);
+			unflushed = 0;
+		}
+
+		if (stopping)
+		{
+			break;
+		}
+
+		if (attempt < 64) BoundedQueue<std::string>::back_off(attempt++);
+		else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
@@ -0,0 +1,99 @@
+// Logger.h
+
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <thread>
+
+#include "BoundedQueue.h"
+
+/// <summary>
+/// Logs a message if its level is active: the message expression is not evaluated otherwise,
+/// so that disabled records cost a single compare.
+/// </summary>
+#define WHITERABBITHOLE_LOG(logger, level, message) \
+	do { if ((logger)->is_enabled(level)) (logger)->write(message); } while (0)
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Describes the importance of a log record, from the most verbose.
+		/// </summary>
+		enum LogLevel { Trace, Debug, Info, Warning, Error, Silent };
+
+		/// <summary>
+		/// Asynchronous logger: records are pushed to a lock-free ring buffer and written to the
+		/// stream by a background thread, which flushes the stream only when it runs out of records.
+		/// Records below the active level are discarded (see WHITERABBITHOLE_LOG).
+		/// </summary>
+		class Logger
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class and starts the writer thread.
+			/// </summary>
+			/// <param name="stream">The stream to write to (not owned).</param>
+			/// <param name="level">The active level.</param>
+			/// <param name="capacity">The number of records the ring buffer holds, writers wait when it is full.</param>
+			Logger(std::ostream& stream, LogLevel level = LogLevel::Info, size_t capacity = 4096);
+
+			/// <summary>
+			/// Writes the pending records and stops the writer thread.
+			/// </summary>
+			~Logger();
+
+		private:
+			Logger(const Logger& other);
+
+		private:
+			std::ostream* stream;
+			LogLevel level;
+			BoundedQueue<std::string> records;
+			std::atomic<size_t> pushed_count;
+			std::atomic<size_t> written_count;
+			std::atomic<bool> stopping;
+			std::thread writer;
+
+		public:
+			/// <summary>
+			/// Gets a value indicating whether records of a level are written.
+			/// </summary>
+			inline bool is_enabled(LogLevel level) const { return level >= this->level; }
+
+			/// <summary>
+			/// Gets the active level.
+			/// </summary>
+			LogLevel get_level() const;
+
+			/// <summary>
+			/// Queues a record (the level is checked by the caller, see WHITERABBITHOLE_LOG).
+			/// </summary>
+			/// <param name="message">The record, a line without its end.</param>
+			void write(std::string message);
+
+			/// <summary>
+			/// Waits until all the records queued so far are written and the stream flushed.
+			/// </summary>
+			void flush();
+
+			/// <summary>
+			/// Parses a level name (trace, debug, info, warning, error, silent).
+			/// </summary>
+			/// <param name="name">The name.</param>
+			/// <param name="level">The parsed level.</param>
+			/// <returns>A value indicating whether the name is known.</returns>
+			static bool parse_level(const std::string& name, LogLevel* level);
+
+		private:
+			void run_writer();
+		}; // class Logger
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
@@ -314,6 +314,22 @@ std::string MD5::hexdigest() const
 
 //////////////////////////////
 
+// return the digest as the four 32 bit words of the final state,
+// the digest bytes being their little-endian encoding
+void MD5::digestwords(unsigned int words[4]) const
+{
+    if (!finalized)
+    {
+        memset(words, 0, 4 * sizeof(unsigned int));
+        return;
+    }
+
+    for (int i = 0; i < 4; i++)
+        words[i] = state[i];
+}
+
+//////////////////////////////
+
 std::ostream& operator<<(std::ostream& out, MD5 md5)
 {
     return out << md5.hexdigest();
@@ -29,6 +29,7 @@ public:
 	void update(const char* buf, size_type length);
 	MD5& finalize();
 	std::string hexdigest() const;
+	void digestwords(unsigned int words[4]) const;
 	friend std::ostream& operator<<(std::ostream&, MD5 md5);
 
 private:
@@ -0,0 +1,54 @@
+// MD5Avx2.cpp
+
+#include "MD5Kernels.h"
+
+#ifdef WHITERABBITHOLE_X86
+
+#include <immintrin.h>
+
+#include "MD5Lanes.h"
+
+namespace {
+
+	struct Avx2Lanes {
+		typedef __m256i vec_t;
+		static const size_t lanes = 8;
+
+		static inline vec_t load(const uint32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+		static inline void store(uint32_t* p, vec_t v) { _mm256_storeu_si256((__m256i*)p, v); }
+		static inline vec_t set1(uint32_t v) { return _mm256_set1_epi32((int)v); }
+		static inline vec_t add(vec_t a, vec_t b) { return _mm256_add_epi32(a, b); }
+		template <int n> static inline vec_t rotl(vec_t x) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+
+		static inline vec_t f(vec_t x, vec_t y, vec_t z) { return _mm256_or_si256(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z)); }
+		static inline vec_t g(vec_t x, vec_t y, vec_t z) { return _mm256_or_si256(_mm256_and_si256(x, z), _mm256_andnot_si256(z, y)); }
+		static inline vec_t h(vec_t x, vec_t y, vec_t z) { return _mm256_xor_si256(_mm256_xor_si256(x, y), z); }
+		static inline vec_t i(vec_t x, vec_t y, vec_t z) { return _mm256_xor_si256(y, _mm256_or_si256(x, _mm256_xor_si256(z, _mm256_set1_epi32(-1)))); }
+		static inline uint32_t eq_mask(vec_t a, vec_t b) { return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))); }
+	};
+
+} // namespace
+
+void challenge::whiterabbithole::md5_hash_avx2(const char* const* messages, const size_t* lengths, digest_t* digests)
+{
+	md5_lanes_hash<Avx2Lanes>(messages, lengths, digests);
+}
+
+uint32_t challenge::whiterabbithole::md5_early_check_avx2(const char* const* messages, const size_t* lengths,
+	const md5_early_check_t& check)
+{
+	return md5_lanes_early_check<Avx2Lanes>(messages, lengths, check);
+}
+
+void challenge::whiterabbithole::md5_hash_words_avx2(const uint32_t* words, size_t stride, digest_t* digests)
+{
+	md5_lanes_hash_words<Avx2Lanes>(words, stride, digests);
+}
+
+uint32_t challenge::whiterabbithole::md5_early_check_words_avx2(const uint32_t* words, size_t stride,
+	const md5_early_check_t& check)
+{
+	return md5_lanes_early_check_words<Avx2Lanes>(words, stride, check);
+}
+
+#endif
@@ -0,0 +1,55 @@
+// MD5Avx512.cpp
+
+#include "MD5Kernels.h"
+
+#ifdef WHITERABBITHOLE_X86
+
+#include <immintrin.h>
+
+#include "MD5Lanes.h"
+
+namespace {
+
+	// Native rotations, and ternary logic evaluates each boolean function in one instruction
+	struct Avx512Lanes {
+		typedef __m512i vec_t;
+		static const size_t lanes = 16;
+
+		static inline vec_t load(const uint32_t* p) { return _mm512_loadu_si512((const void*)p); }
+		static inline void store(uint32_t* p, vec_t v) { _mm512_storeu_si512((void*)p, v); }
+		static inline vec_t set1(uint32_t v) { return _mm512_set1_epi32((int)v); }
+		static inline vec_t add(vec_t a, vec_t b) { return _mm512_add_epi32(a, b); }
+		template <int n> static inline vec_t rotl(vec_t x) { return _mm512_rol_epi32(x, n); }
+
+		static inline vec_t f(vec_t x, vec_t y, vec_t z) { return _mm512_ternarylogic_epi32(x, y, z, 0xCA); }
+		static inline vec_t g(vec_t x, vec_t y, vec_t z) { return _mm512_ternarylogic_epi32(x, y, z, 0xE4); }
+		static inline vec_t h(vec_t x, vec_t y, vec_t z) { return _mm512_ternarylogic_epi32(x, y, z, 0x96); }
+		static inline vec_t i(vec_t x, vec_t y, vec_t z) { return _mm512_ternarylogic_epi32(x, y, z, 0x39); }
+		static inline uint32_t eq_mask(vec_t a, vec_t b) { return (uint32_t)_mm512_cmpeq_epi32_mask(a, b); }
+	};
+
+} // namespace
+
+void challenge::whiterabbithole::md5_hash_avx512(const char* const* messages, const size_t* lengths, digest_t* digests)
+{
+	md5_lanes_hash<Avx512Lanes>(messages, lengths, digests);
+}
+
+uint32_t challenge::whiterabbithole::md5_early_check_avx512(const char* const* messages, const size_t* lengths,
+	const md5_early_check_t& check)
+{
+	return md5_lanes_early_check<Avx512Lanes>(messages, lengths, check);
+}
+
+void challenge::whiterabbithole::md5_hash_words_avx512(const uint32_t* words, size_t stride, digest_t* digests)
+{
+	md5_lanes_hash_words<Avx512Lanes>(words, stride, digests);
+}
+
+uint32_t challenge::whiterabbithole::md5_early_check_words_avx512(const uint32_t* words, size_t stride,
+	const md5_early_check_t& check)
+{
+	return md5_lanes_early_check_words<Avx512Lanes>(words, stride, check);
+}
+
+#endif
@@ -0,0 +1,82 @@
+// MD5Kernels.h
+// Entry points of the SIMD MD5 kernels, each one compiled with its own instruction set.
+// Only call a kernel when get_cpu_features() reports its instruction set.
+
+#ifndef MD5KERNELS_H_
+#define MD5KERNELS_H_
+
+#include "Cpu.h"
+#include "Hashing.h"
+
+namespace challenge {
+	namespace whiterabbithole {
+
+#ifdef WHITERABBITHOLE_X86
+		/// <summary>
+		/// Hashes 4 single-block messages with SSE2.
+		/// </summary>
+		void md5_hash_sse2(const char* const* messages, const size_t* lengths, digest_t* digests);
+
+		/// <summary>
+		/// Hashes 8 single-block messages with AVX2.
+		/// </summary>
+		void md5_hash_avx2(const char* const* messages, const size_t* lengths, digest_t* digests);
+
+		/// <summary>
+		/// Hashes 16 single-block messages with AVX-512.
+		/// </summary>
+		void md5_hash_avx512(const char* const* messages, const size_t* lengths, digest_t* digests);
+
+		/// <summary>
+		/// Runs the early check of 4 single-block messages with SSE2.
+		/// </summary>
+		uint32_t md5_early_check_sse2(const char* const* messages, const size_t* lengths,
+			const md5_early_check_t& check);
+
+		/// <summary>
+		/// Runs the early check of 8 single-block messages with AVX2.
+		/// </summary>
+		uint32_t md5_early_check_avx2(const char* const* messages, const size_t* lengths,
+			const md5_early_check_t& check);
+
+		/// <summary>
+		/// Runs the early check of 16 single-block messages with AVX-512.
+		/// </summary>
+		uint32_t md5_early_check_avx512(const char* const* messages, const size_t* lengths,
+			const md5_early_check_t& check);
+
+		/// <summary>
+		/// Hashes 4 single-block messages laid out word by word with SSE2.
+		/// </summary>
+		void md5_hash_words_sse2(const uint32_t* words, size_t stride, digest_t* digests);
+
+		/// <summary>
+		/// Hashes 8 single-block messages laid out word by word with AVX2.
+		/// </summary>
+		void md5_hash_words_avx2(const uint32_t* words, size_t stride, digest_t* digests);
+
+		/// <summary>
+		/// Hashes 16 single-block messages laid out word by word with AVX-512.
+		/// </summary>
+		void md5_hash_words_avx512(const uint32_t* words, size_t stride, digest_t* digests);
+
+		/// <summary>
+		/// Runs the early check of 4 single-block messages laid out word by word with SSE2.
+		/// </summary>
+		uint32_t md5_early_check_words_sse2(const uint32_t* words, size_t stride, const md5_early_check_t& check);
+
+		/// <summary>
+		/// Runs the early check of 8 single-block messages laid out word by word with AVX2.
+		/// </summary>
+		uint32_t md5_early_check_words_avx2(const uint32_t* words, size_t stride, const md5_early_check_t& check);
+
+		/// <summary>
+		/// Runs the early check of 16 single-block messages laid out word by word with AVX-512.
+		/// </summary>
+		uint32_t md5_early_check_words_avx512(const uint32_t* words, size_t stride, const md5_early_check_t& check);
+#endif
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
@@ -0,0 +1,294 @@
+// MD5Lanes.h
+// Multi-lane MD5: the same round function runs on several independent messages at once,
+// one message per lane of a vector register.
+//
+// Everything here is a template over the lane traits (or has internal linkage), because
+// every SIMD kernel translation unit includes it with its own code generation flags.
+//
+// Lane traits V must provide:
+// - vec_t: the register type, lanes: the number of 32-bit lanes
+// - load(const uint32_t*), store(uint32_t*, vec_t), set1(uint32_t)
+// - add(vec_t, vec_t), rotl<n>(vec_t)
+// - f, g, h, i(vec_t, vec_t, vec_t): the MD5 boolean functions
+// - eq_mask(vec_t, vec_t): bit i set when lane i of both vectors is equal
+
+#ifndef MD5LANES_H_
+#define MD5LANES_H_
+
+#include <cstring>
+
+#include "Hashing.h"
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		// MD5 initialization constants
+		const uint32_t md5_init_a = 0x67452301;
+		const uint32_t md5_init_b = 0xefcdab89;
+		const uint32_t md5_init_c = 0x98badcfe;
+		const uint32_t md5_init_d = 0x10325476;
+
+#define MD5_LANES_STEP(fn, a, b, c, d, k, s, ac) \
+	a = V::add(V::template rotl<s>(V::add(V::add(a, V::fn(b, c, d)), V::add(x[k], V::set1(ac)))), b)
+
+		/// <summary>
+		/// Runs MD5 steps 1 to 59 (the last one updates c).
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_steps_to_59(const typename V::vec_t x[16],
+			typename V::vec_t& a, typename V::vec_t& b, typename V::vec_t& c, typename V::vec_t& d)
+		{
+			// Round 1
+			MD5_LANES_STEP(f, a, b, c, d, 0, 7, 0xd76aa478);
+			MD5_LANES_STEP(f, d, a, b, c, 1, 12, 0xe8c7b756);
+			MD5_LANES_STEP(f, c, d, a, b, 2, 17, 0x242070db);
+			MD5_LANES_STEP(f, b, c, d, a, 3, 22, 0xc1bdceee);
+			MD5_LANES_STEP(f, a, b, c, d, 4, 7, 0xf57c0faf);
+			MD5_LANES_STEP(f, d, a, b, c, 5, 12, 0x4787c62a);
+			MD5_LANES_STEP(f, c, d, a, b, 6, 17, 0xa8304613);
+			MD5_LANES_STEP(f, b, c, d, a, 7, 22, 0xfd469501);
+			MD5_LANES_STEP(f, a, b, c, d, 8, 7, 0x698098d8);
+			MD5_LANES_STEP(f, d, a, b, c, 9, 12, 0x8b44f7af);
+			MD5_LANES_STEP(f, c, d, a, b, 10, 17, 0xffff5bb1);
+			MD5_LANES_STEP(f, b, c, d, a, 11, 22, 0x895cd7be);
+			MD5_LANES_STEP(f, a, b, c, d, 12, 7, 0x6b901122);
+			MD5_LANES_STEP(f, d, a, b, c, 13, 12, 0xfd987193);
+			MD5_LANES_STEP(f, c, d, a, b, 14, 17, 0xa679438e);
+			MD5_LANES_STEP(f, b, c, d, a, 15, 22, 0x49b40821);
+
+			// Round 2
+			MD5_LANES_STEP(g, a, b, c, d, 1, 5, 0xf61e2562);
+			MD5_LANES_STEP(g, d, a, b, c, 6, 9, 0xc040b340);
+			MD5_LANES_STEP(g, c, d, a, b, 11, 14, 0x265e5a51);
+			MD5_LANES_STEP(g, b, c, d, a, 0, 20, 0xe9b6c7aa);
+			MD5_LANES_STEP(g, a, b, c, d, 5, 5, 0xd62f105d);
+			MD5_LANES_STEP(g, d, a, b, c, 10, 9, 0x02441453);
+			MD5_LANES_STEP(g, c, d, a, b, 15, 14, 0xd8a1e681);
+			MD5_LANES_STEP(g, b, c, d, a, 4, 20, 0xe7d3fbc8);
+			MD5_LANES_STEP(g, a, b, c, d, 9, 5, 0x21e1cde6);
+			MD5_LANES_STEP(g, d, a, b, c, 14, 9, 0xc33707d6);
+			MD5_LANES_STEP(g, c, d, a, b, 3, 14, 0xf4d50d87);
+			MD5_LANES_STEP(g, b, c, d, a, 8, 20, 0x455a14ed);
+			MD5_LANES_STEP(g, a, b, c, d, 13, 5, 0xa9e3e905);
+			MD5_LANES_STEP(g, d, a, b, c, 2, 9, 0xfcefa3f8);
+			MD5_LANES_STEP(g, c, d, a, b, 7, 14, 0x676f02d9);
+			MD5_LANES_STEP(g, b, c, d, a, 12, 20, 0x8d2a4c8a);
+
+			// Round 3
+			MD5_LANES_STEP(h, a, b, c, d, 5, 4, 0xfffa3942);
+			MD5_LANES_STEP(h, d, a, b, c, 8, 11, 0x8771f681);
+			MD5_LANES_STEP(h, c, d, a, b, 11, 16, 0x6d9d6122);
+			MD5_LANES_STEP(h, b, c, d, a, 14, 23, 0xfde5380c);
+			MD5_LANES_STEP(h, a, b, c, d, 1, 4, 0xa4beea44);
+			MD5_LANES_STEP(h, d, a, b, c, 4, 11, 0x4bdecfa9);
+			MD5_LANES_STEP(h, c, d, a, b, 7, 16, 0xf6bb4b60);
+			MD5_LANES_STEP(h, b, c, d, a, 10, 23, 0xbebfbc70);
+			MD5_LANES_STEP(h, a, b, c, d, 13, 4, 0x289b7ec6);
+			MD5_LANES_STEP(h, d, a, b, c, 0, 11, 0xeaa127fa);
+			MD5_LANES_STEP(h, c, d, a, b, 3, 16, 0xd4ef3085);
+			MD5_LANES_STEP(h, b, c, d, a, 6, 23, 0x04881d05);
+			MD5_LANES_STEP(h, a, b, c, d, 9, 4, 0xd9d4d039);
+			MD5_LANES_STEP(h, d, a, b, c, 12, 11, 0xe6db99e5);
+			MD5_LANES_STEP(h, c, d, a, b, 15, 16, 0x1fa27cf8);
+			MD5_LANES_STEP(h, b, c, d, a, 2, 23, 0xc4ac5665);
+
+			// Round 4
+			MD5_LANES_STEP(i, a, b, c, d, 0, 6, 0xf4292244);
+			MD5_LANES_STEP(i, d, a, b, c, 7, 10, 0x432aff97);
+			MD5_LANES_STEP(i, c, d, a, b, 14, 15, 0xab9423a7);
+			MD5_LANES_STEP(i, b, c, d, a, 5, 21, 0xfc93a039);
+			MD5_LANES_STEP(i, a, b, c, d, 12, 6, 0x655b59c3);
+			MD5_LANES_STEP(i, d, a, b, c, 3, 10, 0x8f0ccc92);
+			MD5_LANES_STEP(i, c, d, a, b, 10, 15, 0xffeff47d);
+			MD5_LANES_STEP(i, b, c, d, a, 1, 21, 0x85845dd1);
+			MD5_LANES_STEP(i, a, b, c, d, 8, 6, 0x6fa87e4f);
+			MD5_LANES_STEP(i, d, a, b, c, 15, 10, 0xfe2ce6e0);
+			MD5_LANES_STEP(i, c, d, a, b, 6, 15, 0xa3014314);
+		}
+
+		/// <summary>
+		/// Runs MD5 step 60 (updates b).
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_step_60(const typename V::vec_t x[16],
+			typename V::vec_t& a, typename V::vec_t& b, typename V::vec_t& c, typename V::vec_t& d)
+		{
+			MD5_LANES_STEP(i, b, c, d, a, 13, 21, 0x4e0811a1);
+		}
+
+		/// <summary>
+		/// Runs MD5 steps 61 to 64.
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_steps_from_61(const typename V::vec_t x[16],
+			typename V::vec_t& a, typename V::vec_t& b, typename V::vec_t& c, typename V::vec_t& d)
+		{
+			MD5_LANES_STEP(i, a, b, c, d, 4, 6, 0xf7537e82);
+			MD5_LANES_STEP(i, d, a, b, c, 11, 10, 0xbd3af235);
+			MD5_LANES_STEP(i, c, d, a, b, 2, 15, 0x2ad7d2bb);
+			MD5_LANES_STEP(i, b, c, d, a, 9, 21, 0xeb86d391);
+		}
+
+		/// <summary>
+		/// Applies the MD5 compression function to one block per lane, feed-forward included.
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_transform(const typename V::vec_t x[16], typename V::vec_t state[4])
+		{
+			typename V::vec_t a = state[0], b = state[1], c = state[2], d = state[3];
+			md5_lanes_steps_to_59<V>(x, a, b, c, d);
+			md5_lanes_step_60<V>(x, a, b, c, d);
+			md5_lanes_steps_from_61<V>(x, a, b, c, d);
+
+			state[0] = V::add(state[0], a);
+			state[1] = V::add(state[1], b);
+			state[2] = V::add(state[2], c);
+			state[3] = V::add(state[3], d);
+		}
+
+		/// <summary>
+		/// Writes a message shorter than md5_single_block_limit into a block of 16 words,
+		/// with MD5 padding and length. Assumes a little-endian target.
+		/// </summary>
+		static inline void md5_pad_single_block(const char* message, size_t length, uint32_t block[16])
+		{
+			unsigned char* bytes = (unsigned char*)block;
+			memset(bytes, 0, 64);
+			memcpy(bytes, message, length);
+			bytes[length] = 0x80;
+			block[14] = (uint32_t)(length << 3);
+		}
+
+		/// <summary>
+		/// Loads V::lanes single-block messages, one per lane, as the 16 words of their block.
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_load(const char* const* messages, const size_t* lengths, typename V::vec_t x[16])
+		{
+			uint32_t words[16][V::lanes];
+			for (size_t lane = 0; lane < V::lanes; lane++)
+			{
+				uint32_t block[16];
+				md5_pad_single_block(messages[lane], lengths[lane], block);
+				for (size_t k = 0; k < 16; k++)
+				{
+					words[k][lane] = block[k];
+				}
+			}
+
+			for (size_t k = 0; k < 16; k++)
+			{
+				x[k] = V::load(words[k]);
+			}
+		}
+
+		/// <summary>
+		/// Loads V::lanes single-block messages laid out word by word (see HashVerifier::match_words):
+		/// every message word of all lanes is a single load.
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_load_words(const uint32_t* words, size_t stride, typename V::vec_t x[16])
+		{
+			for (size_t k = 0; k < 16; k++)
+			{
+				x[k] = V::load(words + k * stride);
+			}
+		}
+
+		/// <summary>
+		/// Hashes V::lanes loaded blocks at once.
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_hash_blocks(const typename V::vec_t x[16], digest_t* digests)
+		{
+			typename V::vec_t state[4] = {
+				V::set1(md5_init_a), V::set1(md5_init_b), V::set1(md5_init_c), V::set1(md5_init_d)
+			};
+			md5_lanes_transform<V>(x, state);
+
+			uint32_t out[4][V::lanes];
+			for (size_t j = 0; j < 4; j++)
+			{
+				V::store(out[j], state[j]);
+			}
+			for (size_t lane = 0; lane < V::lanes; lane++)
+			{
+				for (size_t j = 0; j < 4; j++)
+				{
+					digests[lane].words[j] = out[j][lane];
+				}
+			}
+		}
+
+		/// <summary>
+		/// Hashes V::lanes single-block messages at once.
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_hash(const char* const* messages, const size_t* lengths, digest_t* digests)
+		{
+			typename V::vec_t x[16];
+			md5_lanes_load<V>(messages, lengths, x);
+			md5_lanes_hash_blocks<V>(x, digests);
+		}
+
+		/// <summary>
+		/// Hashes V::lanes single-block messages laid out word by word at once.
+		/// </summary>
+		template <class V>
+		inline void md5_lanes_hash_words(const uint32_t* words, size_t stride, digest_t* digests)
+		{
+			typename V::vec_t x[16];
+			md5_lanes_load_words<V>(words, stride, x);
+			md5_lanes_hash_blocks<V>(x, digests);
+		}
+
+		/// <summary>
+		/// Runs the early check of V::lanes loaded blocks: only the steps up to the check step
+		/// are computed.
+		/// </summary>
+		/// <returns>The mask of the lanes passing the check (candidates for a full compare).</returns>
+		template <class V>
+		inline uint32_t md5_lanes_early_check_blocks(const typename V::vec_t x[16], const md5_early_check_t& check)
+		{
+			typename V::vec_t a = V::set1(md5_init_a), b = V::set1(md5_init_b),
+				c = V::set1(md5_init_c), d = V::set1(md5_init_d);
+			md5_lanes_steps_to_59<V>(x, a, b, c, d);
+			if (check.step == 59)
+			{
+				return V::eq_mask(V::add(c, x[2]), V::set1(check.value));
+			}
+
+			md5_lanes_step_60<V>(x, a, b, c, d);
+			return V::eq_mask(V::add(b, x[9]), V::set1(check.value));
+		}
+
+		/// <summary>
+		/// Runs the early check of V::lanes single-block messages.
+		/// </summary>
+		/// <returns>The mask of the lanes passing the check (candidates for a full compare).</returns>
+		template <class V>
+		inline uint32_t md5_lanes_early_check(const char* const* messages, const size_t* lengths,
+			const md5_early_check_t& check)
+		{
+			typename V::vec_t x[16];
+			md5_lanes_load<V>(messages, lengths, x);
+			return md5_lanes_early_check_blocks<V>(x, check);
+		}
+
+		/// <summary>
+		/// Runs the early check of V::lanes single-block messages laid out word by word.
+		/// </summary>
+		/// <returns>The mask of the lanes passing the check (candidates for a full compare).</returns>
+		template <class V>
+		inline uint32_t md5_lanes_early_check_words(const uint32_t* words, size_t stride,
+			const md5_early_check_t& check)
+		{
+			typename V::vec_t x[16];
+			md5_lanes_load_words<V>(words, stride, x);
+			return md5_lanes_early_check_blocks<V>(x, check);
+		}
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
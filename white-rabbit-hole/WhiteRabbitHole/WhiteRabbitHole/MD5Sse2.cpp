@@ -0,0 +1,54 @@
+// MD5Sse2.cpp
+
+#include "MD5Kernels.h"
+
+#ifdef WHITERABBITHOLE_X86
+
+#include <emmintrin.h>
+
+#include "MD5Lanes.h"
+
+namespace {
+
+	struct Sse2Lanes {
+		typedef __m128i vec_t;
+		static const size_t lanes = 4;
+
+		static inline vec_t load(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+		static inline void store(uint32_t* p, vec_t v) { _mm_storeu_si128((__m128i*)p, v); }
+		static inline vec_t set1(uint32_t v) { return _mm_set1_epi32((int)v); }
+		static inline vec_t add(vec_t a, vec_t b) { return _mm_add_epi32(a, b); }
+		template <int n> static inline vec_t rotl(vec_t x) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+
+		static inline vec_t f(vec_t x, vec_t y, vec_t z) { return _mm_or_si128(_mm_and_si128(x, y), _mm_andnot_si128(x, z)); }
+		static inline vec_t g(vec_t x, vec_t y, vec_t z) { return _mm_or_si128(_mm_and_si128(x, z), _mm_andnot_si128(z, y)); }
+		static inline vec_t h(vec_t x, vec_t y, vec_t z) { return _mm_xor_si128(_mm_xor_si128(x, y), z); }
+		static inline vec_t i(vec_t x, vec_t y, vec_t z) { return _mm_xor_si128(y, _mm_or_si128(x, _mm_xor_si128(z, _mm_set1_epi32(-1)))); }
+		static inline uint32_t eq_mask(vec_t a, vec_t b) { return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+	};
+
+} // namespace
+
+void challenge::whiterabbithole::md5_hash_sse2(const char* const* messages, const size_t* lengths, digest_t* digests)
+{
+	md5_lanes_hash<Sse2Lanes>(messages, lengths, digests);
+}
+
+uint32_t challenge::whiterabbithole::md5_early_check_sse2(const char* const* messages, const size_t* lengths,
+	const md5_early_check_t& check)
+{
+	return md5_lanes_early_check<Sse2Lanes>(messages, lengths, check);
+}
+
+void challenge::whiterabbithole::md5_hash_words_sse2(const uint32_t* words, size_t stride, digest_t* digests)
+{
+	md5_lanes_hash_words<Sse2Lanes>(words, stride, digests);
+}
+
+uint32_t challenge::whiterabbithole::md5_early_check_words_sse2(const uint32_t* words, size_t stride,
+	const md5_early_check_t& check)
+{
+	return md5_lanes_early_check_words<Sse2Lanes>(words, stride, check);
+}
+
+#endif
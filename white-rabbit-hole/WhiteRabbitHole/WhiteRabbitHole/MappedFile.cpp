@@ -0,0 +1,115 @@
+// MappedFile.cpp
+
+#include <exception>
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace challenge::whiterabbithole;
+
+// Ctors
+
+MappedFile::MappedFile(const std::string& path)
+{
+	this->data = 0;
+	this->size = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::exception("Could not open file to map");
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		throw std::exception("Could not get the size of the file to map");
+	}
+	this->size = (size_t)file_size.QuadPart;
+
+	// Empty files cannot be mapped, they just have no content
+	if (this->size > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping)
+		{
+			this->data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			// The view keeps the mapping alive
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		throw std::exception("Could not open file to map");
+	}
+
+	struct stat file_stat;
+	if (fstat(file, &file_stat) != 0)
+	{
+		close(file);
+		throw std::exception("Could not get the size of the file to map");
+	}
+	this->size = (size_t)file_stat.st_size;
+
+	// Empty files cannot be mapped, they just have no content
+	if (this->size > 0)
+	{
+		void* view = mmap(0, this->size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED)
+		{
+			this->data = (const char*)view;
+			// The file is read front to back once
+			madvise(view, this->size, MADV_SEQUENTIAL);
+		}
+	}
+	// The mapping keeps the file alive
+	close(file);
+#endif
+
+	if (this->size > 0 && !this->data)
+	{
+		throw std::exception("Could not map file");
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (!this->data)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(this->data);
+#else
+	munmap((void*)this->data, this->size);
+#endif
+}
+
+// Public methods
+
+const char* MappedFile::get_data() const
+{
+	return this->data;
+}
+
+size_t MappedFile::get_size() const
+{
+	return this->size;
+}
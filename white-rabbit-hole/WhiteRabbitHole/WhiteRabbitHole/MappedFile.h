@@ -0,0 +1,52 @@
+// MappedFile.h
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Maps a whole file read-only in memory, so that its content can be scanned in place
+		/// without copying it. The mapping is released on destruction.
+		/// </summary>
+		class MappedFile
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="path">The path to the file to map.</param>
+			MappedFile(const std::string& path);
+
+			/// <summary>
+			/// Destroys an instance of this class.
+			/// </summary>
+			~MappedFile();
+
+		private:
+			MappedFile(const MappedFile& other);
+
+		private:
+			const char* data;
+			size_t size;
+
+		public:
+			/// <summary>
+			/// Gets the content of the file (not null terminated).
+			/// </summary>
+			const char* get_data() const;
+
+			/// <summary>
+			/// Gets the size of the file in bytes.
+			/// </summary>
+			size_t get_size() const;
+		}; // class MappedFile
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
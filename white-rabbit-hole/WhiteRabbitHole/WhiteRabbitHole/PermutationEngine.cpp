@@ -0,0 +1,71 @@
+// PermutationEngine.cpp
+
+#include "PermutationEngine.h"
+
+using namespace challenge::whiterabbithole;
+
+// Ctors
+
+PermutationEngine::PermutationEngine(size_t slot_count)
+{
+	this->slot_count = slot_count;
+	this->permutation = new unsigned int[slot_count > 0 ? slot_count : 1];
+	this->counters = new unsigned int[slot_count > 0 ? slot_count : 1];
+	this->reset();
+}
+
+PermutationEngine::~PermutationEngine()
+{
+	delete[] this->permutation;
+	delete[] this->counters;
+}
+
+// Public methods
+
+size_t PermutationEngine::get_slot_count() const
+{
+	return this->slot_count;
+}
+
+const unsigned int* PermutationEngine::get_permutation() const
+{
+	return this->permutation;
+}
+
+void PermutationEngine::reset()
+{
+	for (size_t i = 0; i < this->slot_count; i++)
+	{
+		this->permutation[i] = (unsigned int)i;
+		this->counters[i] = 0;
+	}
+	this->level = 1;
+}
+
+// Iterative Heap's algorithm: counters[level] counts the swaps done at that level, a level
+// is exhausted after level swaps and resets while the next one advances
+bool PermutationEngine::next(size_t* first_swapped, size_t* second_swapped)
+{
+	while (this->level < this->slot_count)
+	{
+		if (this->counters[this->level] < this->level)
+		{
+			size_t other = this->level % 2 == 0 ? 0 : this->counters[this->level];
+			unsigned int swapped = this->permutation[other];
+			this->permutation[other] = this->permutation[this->level];
+			this->permutation[this->level] = swapped;
+
+			*first_swapped = other;
+			*second_swapped = this->level;
+
+			this->counters[this->level]++;
+			this->level = 1;
+			return true;
+		}
+
+		this->counters[this->level] = 0;
+		this->level++;
+	}
+
+	return false;
+}
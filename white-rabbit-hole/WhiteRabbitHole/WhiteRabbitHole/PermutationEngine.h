@@ -0,0 +1,68 @@
+// PermutationEngine.h
+
+#ifndef PERMUTATIONENGINE_H_
+#define PERMUTATIONENGINE_H_
+
+#include <cstddef>
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Enumerates the permutations of a fixed number of slots with Heap's algorithm:
+		/// every permutation differs from the previous one by a single swap, done in place.
+		/// Nothing is allocated after construction, the engine can be reset and reused.
+		/// </summary>
+		class PermutationEngine
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="slot_count">The number of slots to permute.</param>
+			PermutationEngine(size_t slot_count);
+
+			/// <summary>
+			/// Destroys an instance of this class.
+			/// </summary>
+			~PermutationEngine();
+
+		private:
+			PermutationEngine(const PermutationEngine& other);
+
+		private:
+			size_t slot_count;
+			unsigned int* permutation;
+			// Heap's algorithm loop counters (the state of the recursion, unrolled)
+			unsigned int* counters;
+			size_t level;
+
+		public:
+			/// <summary>
+			/// Gets the number of slots.
+			/// </summary>
+			size_t get_slot_count() const;
+
+			/// <summary>
+			/// Gets the current permutation: slot i holds index get_permutation()[i].
+			/// </summary>
+			const unsigned int* get_permutation() const;
+
+			/// <summary>
+			/// Restarts from the identity permutation.
+			/// </summary>
+			void reset();
+
+			/// <summary>
+			/// Moves to the next permutation.
+			/// </summary>
+			/// <param name="first_swapped">Receives the first slot changed by the move.</param>
+			/// <param name="second_swapped">Receives the second slot changed by the move.</param>
+			/// <returns>False when all the permutations have been visited.</returns>
+			bool next(size_t* first_swapped, size_t* second_swapped);
+		}; // class PermutationEngine
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
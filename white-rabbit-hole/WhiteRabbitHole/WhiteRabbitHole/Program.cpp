@@ -1,25 +1,122 @@
 ﻿// Program.cpp
 
 #include "Program.h"
+#include <csignal>
+#include <sstream>
+#include <stdexcept>
+
 #include "Solver.h"
+#include "CancelToken.h"
 
 using namespace challenge::whiterabbithole;
 
-int main()
+// Ctrl+C stops the solver, which still prints what it found
+static CancelToken cancel_token;
+
+static void on_interrupt(int /*signal*/)
+{
+	cancel_token.cancel();
+}
+
+int main(int argc, char* argv[])
 {
 	std::cout << "Program started!" << std::endl;
 
+	// Optional tuning flags
+	SolverOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		try
+		{
+			if (arg == "--threads" && i + 1 < argc)
+			{
+				options.thread_count = std::stoul(argv[++i]);
+			}
+			else if (arg == "--split-depth" && i + 1 < argc)
+			{
+				options.split_depth = std::stoul(argv[++i]);
+			}
+			else if (arg == "--pipeline")
+			{
+				options.pipelined = true;
+			}
+			else if (arg == "--hash-threads" && i + 1 < argc)
+			{
+				options.hash_thread_count = std::stoul(argv[++i]);
+			}
+			else if (arg == "--max-results" && i + 1 < argc)
+			{
+				options.max_results = std::stoul(argv[++i]);
+			}
+			else if (arg == "--time-limit" && i + 1 < argc)
+			{
+				options.time_limit = std::chrono::milliseconds((long long)(std::stod(argv[++i]) * 1000));
+			}
+			else if (arg == "--transposition-table" && i + 1 < argc)
+			{
+				options.transposition_table_size = std::stoul(argv[++i]);
+			}
+			else if (arg == "--checkpoint" && i + 1 < argc)
+			{
+				options.checkpoint_path = argv[++i];
+			}
+			else if (arg == "--checkpoint-interval" && i + 1 < argc)
+			{
+				options.checkpoint_interval = std::chrono::seconds(std::stoul(argv[++i]));
+			}
+			else if (arg == "--resume")
+			{
+				options.resume = true;
+			}
+			else if (arg == "--stats" && i + 1 < argc)
+			{
+				// Reported on stderr, away from the log and the result
+				options.stats_stream = &std::cerr;
+				options.stats_interval = std::chrono::seconds(std::stoul(argv[++i]));
+			}
+			else if (arg == "--stats-json" && i + 1 < argc)
+			{
+				options.stats_summary_path = argv[++i];
+			}
+			else if (arg == "--log-level" && i + 1 < argc)
+			{
+				if (!Logger::parse_level(argv[++i], &options.log_level))
+				{
+					std::cout << "Unknown log level: '" << argv[i] << "'" << std::endl;
+					return 1;
+				}
+			}
+			else
+			{
+				std::cout << "Unknown option: '" << arg << "'" << std::endl;
+				return 1;
+			}
+		}
+		catch (const std::logic_error&) // Thrown by std::stoul and std::stod on malformed or out of range values
+		{
+			std::cout << "Invalid value for '" << arg << "'" << std::endl;
+			return 1;
+		}
+	}
+
 	// Acquire anagram phrase
 	std::string anagram_phrase;
 	std::cout << "Type in the anagram phrase..." << std::endl;
 	std::getline(std::cin, anagram_phrase);
 	std::cout << "Anagram phrase acquired: '" << anagram_phrase << "'" << std::endl;
 
-	// Acquire correct phrase hash
+	// Acquire correct phrase hash (or hashes, all searched at once)
 	std::string phrase_hash;
-	std::cout << "Type in the phrase MD5 hash..." << std::endl;
+	std::cout << "Type in the phrase MD5 hash (several can be separated by spaces)..." << std::endl;
 	std::getline(std::cin, phrase_hash);
 	std::cout << "Phrase MD5 hash acquired: '" << phrase_hash << "'" << std::endl;
+	std::vector<std::string> phrase_hashes;
+	std::istringstream phrase_hash_stream(phrase_hash);
+	for (std::string hash; phrase_hash_stream >> hash; )
+	{
+		phrase_hashes.push_back(hash);
+	}
 
 	// Acquire path to words dbfile
 	std::string dbfile_path;
@@ -28,14 +125,31 @@ int main()
 	std::cout << "Word dbfile location acquired: '" << dbfile_path << "'" << std::endl;
 
 	// Allocating solver and running it
-	Solver solver(anagram_phrase, dbfile_path, phrase_hash, std::cout);
+	options.cancel_token = &cancel_token;
+	Solver solver(anagram_phrase, dbfile_path, phrase_hashes, std::cout, options);
 	solver.load_all_res(); // Will log meaningful values out
 
 	std::getline(std::cin, std::string()); // Pause before starting
 
+	std::signal(SIGINT, on_interrupt);
+
 	std::cout << "Starting algorithm..." << std::endl;
 	solver.solve();
 	std::cout << "Algorithm has ended!" << std::endl;
+	switch (solver.get_status())
+	{
+	case Solver::SolveStatus::ResultLimitReached:
+		std::cout << "Stopped early: result limit reached" << std::endl;
+		break;
+	case Solver::SolveStatus::DeadlineReached:
+		std::cout << "Stopped early: time limit reached" << std::endl;
+		break;
+	case Solver::SolveStatus::Cancelled:
+		std::cout << "Stopped early: cancelled" << std::endl;
+		break;
+	default:
+		break;
+	}
 	std::cout << std::endl;
 
 	std::cout << "Printing result..." << std::endl;
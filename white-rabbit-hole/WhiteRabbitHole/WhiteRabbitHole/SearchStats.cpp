@@ -0,0 +1,158 @@
+// SearchStats.cpp
+
+#include <cstdio>
+
+#include "SearchStats.h"
+
+using namespace challenge::whiterabbithole;
+
+// --- SearchCounters --- //
+
+// Ctors
+
+SearchCounters::SearchCounters()
+{
+	this->nodes_visited.store(0);
+	this->subtrees_pruned.store(0);
+	this->leaves_evaluated.store(0);
+	this->candidates_found.store(0);
+	this->hashes_computed.store(0);
+	this->transposition_hits.store(0);
+	this->transposition_misses.store(0);
+	this->transposition_evictions.store(0);
+}
+
+// --- SearchStats --- //
+
+// Ctors
+
+SearchStats::SearchStats(size_t slot_count)
+{
+	this->slot_count = slot_count == 0 ? 1 : slot_count;
+	this->slots = new SearchCounters[this->slot_count];
+	this->start = std::chrono::steady_clock::now();
+	this->phase_start.store(0);
+	this->hashing_start.store(-1);
+	this->phase.store(0);
+	this->tasks_done.store(0);
+	this->task_count.store(0);
+	this->tasks_restored.store(0);
+}
+
+SearchStats::~SearchStats()
+{
+	delete[] this->slots;
+}
+
+// Public methods
+
+SearchCounters* SearchStats::get_counters(size_t slot) const
+{
+	return &(this->slots[slot % this->slot_count]);
+}
+
+size_t SearchStats::get_slot_count() const
+{
+	return this->slot_count;
+}
+
+void SearchStats::start_phase(unsigned int phase, size_t task_count, size_t tasks_done)
+{
+	std::chrono::milliseconds elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - this->start);
+	this->phase_start.store(elapsed.count());
+	this->task_count.store(task_count);
+	this->tasks_done.store(tasks_done);
+	this->tasks_restored.store(tasks_done);
+	this->phase.store(phase);
+}
+
+void SearchStats::start_hashing()
+{
+	std::chrono::milliseconds elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - this->start);
+	this->hashing_start.store(elapsed.count());
+}
+
+void SearchStats::complete_task()
+{
+	this->tasks_done.fetch_add(1, std::memory_order_relaxed);
+}
+
+search_stats_t SearchStats::get_snapshot() const
+{
+	search_stats_t stats = {};
+	for (size_t i = 0; i < this->slot_count; i++)
+	{
+		const SearchCounters& counters = this->slots[i];
+		stats.nodes_visited += counters.nodes_visited.load(std::memory_order_relaxed);
+		stats.subtrees_pruned += counters.subtrees_pruned.load(std::memory_order_relaxed);
+		stats.leaves_evaluated += counters.leaves_evaluated.load(std::memory_order_relaxed);
+		stats.candidates_found += counters.candidates_found.load(std::memory_order_relaxed);
+		stats.hashes_computed += counters.hashes_computed.load(std::memory_order_relaxed);
+		stats.transposition_hits += counters.transposition_hits.load(std::memory_order_relaxed);
+		stats.transposition_misses += counters.transposition_misses.load(std::memory_order_relaxed);
+		stats.transposition_evictions += counters.transposition_evictions.load(std::memory_order_relaxed);
+	}
+
+	stats.phase = this->phase.load();
+	stats.tasks_done = this->tasks_done.load(std::memory_order_relaxed);
+	stats.task_count = this->task_count.load();
+	stats.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+	stats.phase_elapsed_seconds = stats.elapsed_seconds - this->phase_start.load() / 1000.0;
+	if (stats.phase_elapsed_seconds < 0) stats.phase_elapsed_seconds = 0;
+	long long hashing_start = this->hashing_start.load();
+	double hashing_elapsed_seconds = hashing_start >= 0 ? stats.elapsed_seconds - hashing_start / 1000.0 : 0;
+	stats.hashes_per_second = hashing_elapsed_seconds > 0 ? stats.hashes_computed / hashing_elapsed_seconds : 0;
+
+	stats.coverage = stats.task_count > 0 ? (double)stats.tasks_done / stats.task_count : 0;
+	// Tasks done before (fx: restored from a checkpoint) took no time of this phase
+	size_t tasks_run = stats.tasks_done - this->tasks_restored.load();
+	stats.eta_seconds = tasks_run > 0 ?
+		stats.phase_elapsed_seconds * (stats.task_count - stats.tasks_done) / tasks_run : -1;
+
+	return stats;
+}
+
+std::string SearchStats::format_report(const search_stats_t& stats)
+{
+	char line[512];
+	std::snprintf(line, sizeof(line),
+		"[%.1fs] phase %u: %.1f%% (%zu/%zu tasks), ETA %s | nodes %llu, pruned %llu, leaves %llu, "
+		"candidates %llu, hashes %llu (%.0f/s), dead nodes %llu/%llu",
+		stats.elapsed_seconds, stats.phase, stats.coverage * 100, stats.tasks_done, stats.task_count,
+		stats.eta_seconds < 0 ? "?" : (std::to_string((long long)(stats.eta_seconds + 0.5)) + "s").c_str(),
+		stats.nodes_visited, stats.subtrees_pruned, stats.leaves_evaluated,
+		stats.candidates_found, stats.hashes_computed, stats.hashes_per_second,
+		stats.transposition_hits, stats.transposition_hits + stats.transposition_misses);
+	return line;
+}
+
+std::string SearchStats::format_json(const search_stats_t& stats, const std::string& status, size_t results_count)
+{
+	char json[1024];
+	std::snprintf(json, sizeof(json),
+		"{\n"
+		"  \"status\": \"%s\",\n"
+		"  \"results\": %zu,\n"
+		"  \"elapsed_seconds\": %.3f,\n"
+		"  \"phase\": %u,\n"
+		"  \"tasks_done\": %zu,\n"
+		"  \"task_count\": %zu,\n"
+		"  \"coverage\": %.4f,\n"
+		"  \"nodes_visited\": %llu,\n"
+		"  \"subtrees_pruned\": %llu,\n"
+		"  \"leaves_evaluated\": %llu,\n"
+		"  \"candidates_found\": %llu,\n"
+		"  \"hashes_computed\": %llu,\n"
+		"  \"hashes_per_second\": %.1f,\n"
+		"  \"transposition_hits\": %llu,\n"
+		"  \"transposition_misses\": %llu,\n"
+		"  \"transposition_evictions\": %llu\n"
+		"}\n",
+		status.c_str(), results_count, stats.elapsed_seconds, stats.phase, stats.tasks_done, stats.task_count,
+		stats.coverage, stats.nodes_visited, stats.subtrees_pruned, stats.leaves_evaluated,
+		stats.candidates_found, stats.hashes_computed, stats.hashes_per_second,
+		stats.transposition_hits, stats.transposition_misses, stats.transposition_evictions);
+	return json;
+}
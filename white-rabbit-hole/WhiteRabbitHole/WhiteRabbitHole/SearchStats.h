@@ -0,0 +1,157 @@
+// SearchStats.h
+
+#ifndef SEARCHSTATS_H_
+#define SEARCHSTATS_H_
+
+#include <cstddef>
+#include <string>
+#include <atomic>
+#include <chrono>
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Counters of the search run by one thread. Only that thread writes them (a relaxed load
+		/// and store, no locked instruction), any thread can read them at any time.
+		/// </summary>
+		struct SearchCounters {
+		public:
+			SearchCounters();
+		private:
+			SearchCounters(const SearchCounters& other);
+		public:
+			std::atomic<unsigned long long> nodes_visited;
+			std::atomic<unsigned long long> subtrees_pruned;
+			std::atomic<unsigned long long> leaves_evaluated;
+			std::atomic<unsigned long long> candidates_found;
+			std::atomic<unsigned long long> hashes_computed;
+			std::atomic<unsigned long long> transposition_hits;
+			std::atomic<unsigned long long> transposition_misses;
+			std::atomic<unsigned long long> transposition_evictions;
+			// Padded to a cache line so that threads do not false-share their counters
+			char padding[64];
+
+			/// <summary>
+			/// Adds to a counter of this thread.
+			/// </summary>
+			/// <param name="counter">The counter.</param>
+			/// <param name="count">The amount to add.</param>
+			static inline void add(std::atomic<unsigned long long>& counter, unsigned long long count = 1)
+			{
+				counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+			}
+		};
+
+		/// <summary>
+		/// Represents the counters of all threads at some point of a solve.
+		/// </summary>
+		struct search_stats_t {
+		public:
+			unsigned long long nodes_visited;
+			unsigned long long subtrees_pruned;
+			unsigned long long leaves_evaluated;
+			unsigned long long candidates_found;
+			unsigned long long hashes_computed;
+			// Probes of the tables of dead nodes, and the nodes evicted to store new ones
+			unsigned long long transposition_hits;
+			unsigned long long transposition_misses;
+			unsigned long long transposition_evictions;
+			unsigned int phase;
+			size_t tasks_done;
+			size_t task_count;
+			double elapsed_seconds;
+			double phase_elapsed_seconds;
+			// Over the time hashing has run (phase 2, or the whole pipelined search)
+			double hashes_per_second;
+			// Fraction of the tasks of the phase done, and the time they suggest is left (-1 if unknown)
+			double coverage;
+			double eta_seconds;
+		};
+
+		/// <summary>
+		/// Collects the counters of a solve: one SearchCounters per thread, summed on demand,
+		/// and the progress of the phase in tasks (the tasks of a phase have no fixed cost,
+		/// so the coverage is a rough measure of the search space left).
+		/// </summary>
+		class SearchStats
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="slot_count">The number of threads updating counters.</param>
+			SearchStats(size_t slot_count);
+
+			/// <summary>
+			/// Destroys an instance of this class.
+			/// </summary>
+			~SearchStats();
+
+		private:
+			SearchStats(const SearchStats& other);
+
+		private:
+			SearchCounters* slots;
+			size_t slot_count;
+			std::chrono::steady_clock::time_point start;
+			std::atomic<long long> phase_start; // Since start, in milliseconds
+			std::atomic<long long> hashing_start; // Since start, in milliseconds (-1 before hashing)
+			std::atomic<unsigned int> phase;
+			std::atomic<size_t> tasks_done;
+			std::atomic<size_t> task_count;
+			std::atomic<size_t> tasks_restored;
+
+		public:
+			/// <summary>
+			/// Gets the counters of a thread.
+			/// </summary>
+			/// <param name="slot">The slot of the thread.</param>
+			SearchCounters* get_counters(size_t slot) const;
+
+			/// <summary>
+			/// Gets the number of slots.
+			/// </summary>
+			size_t get_slot_count() const;
+
+			/// <summary>
+			/// Moves to a phase.
+			/// </summary>
+			/// <param name="phase">The phase.</param>
+			/// <param name="task_count">The number of tasks of the phase.</param>
+			/// <param name="tasks_done">The number of tasks already done (fx: restored from a checkpoint).</param>
+			void start_phase(unsigned int phase, size_t task_count, size_t tasks_done = 0);
+
+			/// <summary>
+			/// Records that hashing starts: the hash rate is measured from then on.
+			/// </summary>
+			void start_hashing();
+
+			/// <summary>
+			/// Records a task of the phase as done.
+			/// </summary>
+			void complete_task();
+
+			/// <summary>
+			/// Sums the counters of all threads.
+			/// </summary>
+			search_stats_t get_snapshot() const;
+
+			/// <summary>
+			/// Formats a snapshot as a single line for periodic reports.
+			/// </summary>
+			static std::string format_report(const search_stats_t& stats);
+
+			/// <summary>
+			/// Formats a snapshot as a JSON object.
+			/// </summary>
+			/// <param name="stats">The snapshot.</param>
+			/// <param name="status">How the solve ended.</param>
+			/// <param name="results_count">The number of valid phrases found.</param>
+			static std::string format_json(const search_stats_t& stats, const std::string& status, size_t results_count);
+		}; // class SearchStats
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
@@ -1,38 +1,110 @@
 // Solver.cpp
 
 #include <exception>
+#include <cstring>
 #include <algorithm>
 #include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 
 #include "Solver.h"
 #include "Utils.h"
 #include "Hashing.h"
+#include "WorkStealingPool.h"
+#include "MappedFile.h"
+#include "PermutationEngine.h"
 
 using namespace challenge::whiterabbithole;
 
+// Phrases verified at once in phase 2, a multiple of the lanes of every hash kernel
+static const size_t permutation_batch_size = 64;
+
+// Candidates waiting for the hashing threads in pipelined mode
+static const size_t pipeline_queue_capacity = 1024;
+
+// Usewords a combination node has to scan before its children are generated from a trie instead
+static const size_t trie_min_scan_size = 64;
+
 // --- Solver --- //
 
 // Ctors
 
 Solver::Solver(const std::string& anagram_phrase, const std::string& dbfile_path,
-	const std::string& phrase_hash, std::ostream& log_stream)
+	const std::string& phrase_hash, std::ostream& log_stream, const SolverOptions& options)
+	: Solver(anagram_phrase, dbfile_path, std::vector<std::string>(1, phrase_hash), log_stream, options)
+{
+}
+
+Solver::Solver(const std::string& anagram_phrase, const std::string& dbfile_path,
+	const std::vector<std::string>& phrase_hashes, std::ostream& log_stream, const SolverOptions& options)
 {
 	this->anagram_phrase = anagram_phrase;
+	this->options = options;
 	this->dbfile_path = dbfile_path;
 	this->log_stream = &log_stream;
-	this->phrase_hash = phrase_hash;
+	this->logger = new Logger(log_stream, options.log_level);
+	this->phrase_hashes = phrase_hashes;
+
+	// Targets are parsed once, candidates are compared in binary form
+	if (this->phrase_hashes.empty())
+	{
+		throw std::exception("No phrase hash");
+	}
+	for (std::vector<std::string>::const_iterator it = this->phrase_hashes.begin(); it != this->phrase_hashes.end(); it++)
+	{
+		digest_t digest;
+		if (!parse_hash(*it, &digest))
+		{
+			throw std::exception("Invalid phrase hash");
+		}
+		this->phrase_digests.push_back(digest);
+	}
+	this->phrase_verifier = new HashVerifier(this->phrase_digests, this->get_phrase_char_count());
+
+	// Saturated counts would let words with more occurrences than the phrase through
 	this->anagram_phrase_histo = new Histogram(this->anagram_phrase);
+	if (this->anagram_phrase_histo->is_saturated())
+	{
+		throw std::exception("Too many occurrences of a letter in the phrase");
+	}
+	this->anagram_phrase_layout = new LetterSignatureLayout(this->anagram_phrase);
+	this->anagram_phrase_filter = new LetterFilter(this->anagram_phrase);
 	this->words = 0;
 	this->use_words = 0;
+	this->use_words_histos = 0;
+	this->use_words_signatures = 0;
+	this->use_words_class_ends = 0;
+	this->use_words_class_begins = 0;
+	this->use_words_signature_classes = 0;
+	this->use_words_length_counts = 0;
+	this->use_words_rare_letters = 0;
+	this->use_words_letter_buckets = 0;
+	this->use_words_letter_tries = 0;
+	this->use_words_min_length = 0;
+	this->use_words_max_length = 0;
 	this->alphabet = 0;
 	this->result = 0;
+	this->status = SolveStatus::Running;
+	this->stop_status.store(SolveStatus::Running);
+	this->valid_count.store(0);
+	this->checkpoint = 0;
+	this->stats = 0;
 }
 
 Solver::Solver(const Solver& other)
 {
 	this->anagram_phrase = other.anagram_phrase;
 	this->anagram_phrase_histo = new Histogram(this->anagram_phrase);
+	this->anagram_phrase_layout = new LetterSignatureLayout(*(other.anagram_phrase_layout));
+	this->anagram_phrase_filter = new LetterFilter(*(other.anagram_phrase_filter));
 	this->dbfile_path = other.dbfile_path;
+	this->phrase_hashes = other.phrase_hashes;
+	this->phrase_digests = other.phrase_digests;
+	this->phrase_verifier = new HashVerifier(*(other.phrase_verifier));
+	this->options = other.options;
+	this->checkpoint = 0;
+	this->stats = 0;
 
 	// Copy the state as well
 	this->words = new wordset_t();
@@ -41,10 +113,8 @@ Solver::Solver(const Solver& other)
 		*(this->words) = *(other.words);
 	}
 
-	if (other.log_stream)
-	{
-		this->log_stream = other.log_stream;
-	}
+	this->log_stream = other.log_stream;
+	this->logger = new Logger(*(this->log_stream), this->options.log_level);
 	
 	this->use_words = new usewordset_t();
 	if (other.use_words)
@@ -52,6 +122,60 @@ Solver::Solver(const Solver& other)
 		*(this->use_words) = *(other.use_words);
 	}
 
+	this->use_words_histos = new std::vector<Histogram>();
+	if (other.use_words_histos)
+	{
+		*(this->use_words_histos) = *(other.use_words_histos);
+	}
+
+	this->use_words_signatures = new std::vector<letter_signature_t>();
+	if (other.use_words_signatures)
+	{
+		*(this->use_words_signatures) = *(other.use_words_signatures);
+	}
+
+	this->use_words_class_ends = new std::vector<unsigned int>();
+	if (other.use_words_class_ends)
+	{
+		*(this->use_words_class_ends) = *(other.use_words_class_ends);
+	}
+
+	this->use_words_class_begins = new std::unordered_map<std::string, unsigned int>();
+	if (other.use_words_class_begins)
+	{
+		*(this->use_words_class_begins) = *(other.use_words_class_begins);
+	}
+
+	this->use_words_signature_classes =
+		new std::unordered_map<letter_signature_t, unsigned int, letter_signature_hash_t, letter_signature_equal_t>();
+	if (other.use_words_signature_classes)
+	{
+		*(this->use_words_signature_classes) = *(other.use_words_signature_classes);
+	}
+
+	this->use_words_length_counts = new std::map<size_t, unsigned int>();
+	if (other.use_words_length_counts)
+	{
+		*(this->use_words_length_counts) = *(other.use_words_length_counts);
+	}
+	this->use_words_rare_letters = new std::vector<char>();
+	if (other.use_words_rare_letters)
+	{
+		*(this->use_words_rare_letters) = *(other.use_words_rare_letters);
+	}
+	this->use_words_letter_buckets = new std::vector<std::vector<letter_bucket_t>>();
+	if (other.use_words_letter_buckets)
+	{
+		*(this->use_words_letter_buckets) = *(other.use_words_letter_buckets);
+	}
+	this->use_words_letter_tries = new std::vector<WordTrie>();
+	if (other.use_words_letter_tries)
+	{
+		*(this->use_words_letter_tries) = *(other.use_words_letter_tries);
+	}
+	this->use_words_min_length = other.use_words_min_length;
+	this->use_words_max_length = other.use_words_max_length;
+
 	this->alphabet = new alphabet_t();
 	if (other.alphabet)
 	{
@@ -63,10 +187,38 @@ Solver::Solver(const Solver& other)
 	{
 		*(this->result) = *(other.result);
 	}
+	this->status = other.status;
+	this->stop_status.store(other.stop_status.load());
+	this->valid_count.store(other.valid_count.load());
 }
 
 Solver::~Solver()
 {
+	if (this->logger)
+	{
+		delete this->logger;
+	}
+
+	if (this->stats)
+	{
+		delete this->stats;
+	}
+
+	if (this->anagram_phrase_layout)
+	{
+		delete this->anagram_phrase_layout;
+	}
+
+	if (this->anagram_phrase_filter)
+	{
+		delete this->anagram_phrase_filter;
+	}
+
+	if (this->phrase_verifier)
+	{
+		delete this->phrase_verifier;
+	}
+
 	if (this->words)
 	{
 		this->words->clear();
@@ -79,6 +231,60 @@ Solver::~Solver()
 		delete this->use_words;
 	}
 
+	if (this->use_words_histos)
+	{
+		this->use_words_histos->clear();
+		delete this->use_words_histos;
+	}
+
+	if (this->use_words_signatures)
+	{
+		this->use_words_signatures->clear();
+		delete this->use_words_signatures;
+	}
+
+	if (this->use_words_class_ends)
+	{
+		this->use_words_class_ends->clear();
+		delete this->use_words_class_ends;
+	}
+
+	if (this->use_words_class_begins)
+	{
+		this->use_words_class_begins->clear();
+		delete this->use_words_class_begins;
+	}
+
+	if (this->use_words_signature_classes)
+	{
+		this->use_words_signature_classes->clear();
+		delete this->use_words_signature_classes;
+	}
+
+	if (this->use_words_length_counts)
+	{
+		this->use_words_length_counts->clear();
+		delete this->use_words_length_counts;
+	}
+
+	if (this->use_words_rare_letters)
+	{
+		this->use_words_rare_letters->clear();
+		delete this->use_words_rare_letters;
+	}
+
+	if (this->use_words_letter_buckets)
+	{
+		this->use_words_letter_buckets->clear();
+		delete this->use_words_letter_buckets;
+	}
+
+	if (this->use_words_letter_tries)
+	{
+		this->use_words_letter_tries->clear();
+		delete this->use_words_letter_tries;
+	}
+
 	if (this->alphabet)
 	{
 		this->alphabet->clear();
@@ -100,47 +306,100 @@ void Solver::solve()
 	this->load_all_res();
 
 	unsigned int words_count = this->get_phrase_words_count();
+	this->status = SolveStatus::Running;
+	this->stop_status.store(SolveStatus::Running);
+	this->valid_count.store(0);
+
+	if (this->stats) delete this->stats;
+	this->stats = new SearchStats(this->get_thread_count() +
+		(this->options.pipelined ? this->get_hash_thread_count() : 0));
+
+	// The deadline is watched by a thread of its own, so the search only polls a flag
+	std::mutex deadline_mutex;
+	std::condition_variable deadline_condition;
+	bool phases_done = false;
+	std::thread deadline_watcher;
+	if (this->options.time_limit.count() > 0)
+	{
+		deadline_watcher = std::thread([&]()
+		{
+			std::unique_lock<std::mutex> lock(deadline_mutex);
+			if (!deadline_condition.wait_for(lock, this->options.time_limit, [&]() { return phases_done; }))
+			{
+				this->request_stop(SolveStatus::DeadlineReached);
+			}
+		});
+	}
 
-	// When true, this will use a 2-phase approach:
-	// 1. Evaluate combinations of words (not dispositions). In this phase, the words
-	//    are checked and the histograms as well.
-	// 2. Evaluate all dispositions of the found combinations and check hash.
-	//    This is an exhaustive approach on a very small set of words as we scan
-	//    dispositions of single combinations.
-	bool use_combinations = true;
+	// Counters are reported by a thread of their own as well
+	std::thread reporter;
+	if (this->options.stats_stream && this->options.stats_interval.count() > 0)
+	{
+		reporter = std::thread([&]()
+		{
+			std::unique_lock<std::mutex> lock(deadline_mutex);
+			while (!deadline_condition.wait_for(lock, this->options.stats_interval, [&]() { return phases_done; }))
+			{
+				std::string report = SearchStats::format_report(this->stats->get_snapshot());
+				std::lock_guard<std::mutex> guard(this->stats_mutex);
+				*(this->options.stats_stream) << report << std::endl;
+			}
+		});
+	}
 
-	// Take combinations of use_words in groups of words_count, so
-	// check the length of the sentence keeping into account the spaces
-	DispositionsTreeWalkState* state = new DispositionsTreeWalkState();
-	result_t result_combinations; // If result_combinations == true => those are dispositions
-	this->log("Executing searching candidates...");
-	this->walk_dispositions(*(this->use_words), words_count, state, &result_combinations, use_combinations);
-	this->log("Candidate search job done!");
-	delete state;
-	size_t result_combinations_size = result_combinations.size();
-	this->log("Found " + std::to_string(result_combinations_size) + " candidates!");
+	if (!this->options.checkpoint_path.empty())
+	{
+		this->checkpoint = new Checkpoint(this->options.checkpoint_path,
+			this->get_checkpoint_fingerprint(), this->options.checkpoint_interval);
+	}
 
-	if (!use_combinations)
+	std::exception_ptr error;
+	try
 	{
-		*(this->result) = result_combinations;
-		return;
+		this->run_phases(words_count);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
 	}
 
-	// Take dispositions of the found valid phrases and check hash
-	result_t result_dispositions;
-	this->log("Executing searching valid dispositions (from each candidate combination)...");
-	unsigned int i = 1;
-	for (result_t::const_iterator it = result_combinations.begin(), end = result_combinations.end(); it != end; it++, i++)
+	if (this->checkpoint)
 	{
-		this->log("Running dispositions on combination: " + phrase_to_string(*it) + " - " +
-			std::to_string(i) + "/" + std::to_string(result_combinations_size)); // Verbose
-		state = new DispositionsTreeWalkState();
-		this->walk_dispositions(*it, words_count, state, &result_dispositions, false); // No caching = all dispositions
-		delete state;
+		// A complete search leaves nothing to resume
+		if (!error && !this->is_stop_requested())
+		{
+			this->checkpoint->remove();
+		}
+		delete this->checkpoint;
+		this->checkpoint = 0;
 	}
-	this->log("Valid dispositions search job done!");
 
-	*(this->result) = result_dispositions;
+	{
+		std::lock_guard<std::mutex> guard(deadline_mutex);
+		phases_done = true;
+	}
+	deadline_condition.notify_all();
+	if (deadline_watcher.joinable()) deadline_watcher.join();
+	if (reporter.joinable()) reporter.join();
+
+	// The caller writes to the log stream next
+	this->logger->flush();
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+
+	// Workers may overshoot the limit while they notice the stop
+	if (this->options.max_results > 0 && this->result->size() > this->options.max_results)
+	{
+		this->result->resize(this->options.max_results);
+	}
+
+	this->status = this->stop_status.load() == SolveStatus::Running ?
+		SolveStatus::Completed : (SolveStatus)this->stop_status.load();
+
+	this->write_stats_summary();
 }
 
 void Solver::load_all_res()
@@ -150,21 +409,22 @@ void Solver::load_all_res()
 		if (!this->words)
 		{
 			// Load the db file on demand only once
-			this->log("Loading words...");
-			this->load_words();
-			this->log("Words loaded: " + std::to_string(this->words->size()));
+			this->log(LogLevel::Info, "Loading words...");
+			size_t loaded_count = this->load_words();
+			this->log(LogLevel::Info, "Words loaded: " + std::to_string(loaded_count));
 		}
 
 		// Extract the usewords from words (and also handle the alphabet)
-		this->log("Processing words...");
+		this->log(LogLevel::Info, "Processing words...");
 		this->process_words();
-		this->log("Usewords loaded: " + std::to_string(this->use_words->size()));
+		this->log(LogLevel::Info, "Usewords loaded: " + std::to_string(this->use_words->size()));
+		this->log(LogLevel::Info, "Useword anagram classes: " + std::to_string(this->use_words_class_begins->size()));
 	}
 
 	if (this->use_words->size() <= 350)
 	{
 		unsigned int disposition_count = this->get_disposition_count(this->get_phrase_words_count());
-		this->log("Number of dipositions to try: " + std::to_string(disposition_count));
+		this->log(LogLevel::Info, "Number of dipositions to try: " + std::to_string(disposition_count));
 	}
 
 	if (this->result) this->result->clear();
@@ -175,38 +435,269 @@ void Solver::load_all_res()
 	{
 		alphabet_str += std::string(1, *it) + " ";
 	}
-	this->log("Alphabet: " + alphabet_str);
+	this->log(LogLevel::Info, "Alphabet: " + alphabet_str);
 
-	bool verbose = false;
-	if (verbose)
+	if (this->logger->is_enabled(LogLevel::Trace))
 	{
-		this->log("Use words are (first 100):");
+		this->log(LogLevel::Trace, "Use words are (first 100):");
 		unsigned int i = 100;
 		for (usewordset_t::const_iterator it = this->use_words->begin(); it != this->use_words->end(); it++)
 		{
 			if (i-- == 0) break;
-			this->log("- " + (*it));
+			this->log(LogLevel::Trace, "- " + (*it));
 		}
 	}
+
+	this->logger->flush();
 }
 
 void Solver::print_result(std::ostream& stream) const
 {
 	for (result_t::const_iterator it = this->result->begin(); it != this->result->end(); it++)
 	{
-		stream << "- " << phrase_to_string(*it) << std::endl;
+		stream << "- " << phrase_to_string(*it);
+		if (this->phrase_hashes.size() > 1)
+		{
+			int target = this->match_phrase_hash(*it);
+			if (target >= 0) stream << " (" << this->phrase_hashes[target] << ")";
+		}
+		stream << std::endl;
+	}
+}
+
+const Solver::result_t& Solver::get_result() const
+{
+	return *(this->result);
+}
+
+Solver::SolveStatus Solver::get_status() const
+{
+	return this->status;
+}
+
+search_stats_t Solver::get_stats() const
+{
+	if (!this->stats)
+	{
+		search_stats_t none = {};
+		return none;
+	}
+
+	return this->stats->get_snapshot();
+}
+
+std::string Solver::get_status_name(SolveStatus status)
+{
+	switch (status)
+	{
+	case SolveStatus::Running: return "running";
+	case SolveStatus::Completed: return "completed";
+	case SolveStatus::ResultLimitReached: return "result_limit_reached";
+	case SolveStatus::DeadlineReached: return "deadline_reached";
+	case SolveStatus::Cancelled: return "cancelled";
+	default: return "unknown";
 	}
 }
 
 // Private methods
 
-void Solver::log(const std::string& what) const {
-	if (!this->log_stream)
+void Solver::run_phases(unsigned int words_count)
+{
+	// When true, this will use a 2-phase approach:
+	// 1. Evaluate combinations of words (not dispositions). In this phase, the words
+	//    are checked and the histograms as well.
+	// 2. Evaluate all dispositions of the found combinations and check hash.
+	//    This is an exhaustive approach on a very small set of words as we scan
+	//    dispositions of single combinations.
+	bool use_combinations = true;
+
+	if (this->checkpoint && this->options.resume && this->checkpoint->load())
 	{
+		this->log(LogLevel::Info, "Resuming from checkpoint: phase " + std::to_string(this->checkpoint->get_phase()) + ", " +
+			std::to_string(this->checkpoint->get_completed_count()) + " tasks done");
+	}
+
+	if (use_combinations && this->options.pipelined && this->checkpoint)
+	{
+		// Candidates in the queue belong to no task, progress could not be recorded
+		this->log(LogLevel::Warning, "Checkpoints are not supported by the pipelined search, running the phases one after the other");
+	}
+	else if (use_combinations && this->options.pipelined)
+	{
+		// Both phases at once, candidates are not kept
+		result_t result_dispositions;
+		size_t candidates_count = 0;
+		this->log(LogLevel::Info, "Executing pipelined search (" + std::to_string(this->get_hash_thread_count()) +
+			" hashing threads)...");
+		this->stats->start_hashing(); // Alongside the candidate search
+		this->search_pipelined(words_count, &result_dispositions, &candidates_count);
+		this->log(LogLevel::Info, "Pipelined search job done!");
+		this->log(LogLevel::Info, "Found " + std::to_string(candidates_count) + " candidates!");
+
+		*(this->result) = result_dispositions;
+		return;
+	}
+
+	// Take combinations of use_words in groups of words_count, so
+	// check the length of the sentence keeping into account the spaces
+	result_t result_combinations; // If result_combinations == true => those are dispositions
+	if (this->checkpoint && this->checkpoint->get_phase() == 2)
+	{
+		result_combinations = this->checkpoint->get_candidates();
+		this->log(LogLevel::Info, "Candidates restored from checkpoint");
+	}
+	else
+	{
+		this->log(LogLevel::Info, "Executing searching candidates...");
+		this->search_candidates(words_count, &result_combinations, use_combinations);
+		this->log(LogLevel::Info, "Candidate search job done!");
+	}
+	size_t result_combinations_size = result_combinations.size();
+	this->log(LogLevel::Info, "Found " + std::to_string(result_combinations_size) + " candidates!");
+
+	if (!use_combinations)
+	{
+		*(this->result) = result_combinations;
+		return;
+	}
+
+	// Candidates of an interrupted search are not valid phrases
+	if (this->is_stop_requested())
+	{
+		this->log(LogLevel::Info, "Search stopped, skipping valid dispositions");
+		this->result->clear();
+		if (this->checkpoint) this->checkpoint->save();
 		return;
 	}
 
-	*(this->log_stream) << what << std::endl;
+	if (this->checkpoint && this->checkpoint->get_phase() != 2)
+	{
+		this->checkpoint->set_candidates(result_combinations);
+		this->checkpoint->start_phase(2, result_combinations.size());
+		this->checkpoint->save();
+	}
+
+	// Take dispositions of the found valid phrases and check hash
+	result_t result_dispositions;
+	this->log(LogLevel::Info, "Executing searching valid dispositions (from each candidate combination)...");
+	this->search_valid_dispositions(result_combinations, words_count, &result_dispositions);
+	this->log(LogLevel::Info, "Valid dispositions search job done!");
+	if (this->checkpoint) this->checkpoint->save();
+
+	*(this->result) = result_dispositions;
+}
+
+void Solver::write_stats_summary() const
+{
+	std::string summary = SearchStats::format_json(this->stats->get_snapshot(), get_status_name(this->status),
+		this->result->size());
+	if (this->options.stats_stream)
+	{
+		std::lock_guard<std::mutex> guard(this->stats_mutex);
+		*(this->options.stats_stream) << summary;
+	}
+
+	if (!this->options.stats_summary_path.empty())
+	{
+		std::ofstream file(this->options.stats_summary_path, std::ios::trunc);
+		if (!file.is_open())
+		{
+			throw std::exception("Could not write stats summary file");
+		}
+		file << summary;
+	}
+}
+
+// Everything the search depends on: a checkpoint of another search is rejected (the split depth
+// of the tasks is saved along with them instead, it may depend on the threads)
+std::string Solver::get_checkpoint_fingerprint() const
+{
+	std::string inputs = this->anagram_phrase + "\n";
+	for (std::vector<std::string>::const_iterator it = this->phrase_hashes.begin(); it != this->phrase_hashes.end(); it++)
+	{
+		inputs += *it + " ";
+	}
+	inputs += "\n";
+	for (usewordset_t::const_iterator it = this->use_words->begin(); it != this->use_words->end(); it++)
+	{
+		inputs += *it + "\n";
+	}
+	return get_hash(inputs);
+}
+
+// Polled by the search: a relaxed load when nothing happened (the deadline is turned into a stop
+// request by its own thread)
+bool Solver::is_stop_requested() const
+{
+	if (this->stop_status.load(std::memory_order_relaxed) != SolveStatus::Running)
+	{
+		return true;
+	}
+
+	if (this->options.cancel_token && this->options.cancel_token->is_cancelled())
+	{
+		this->request_stop(SolveStatus::Cancelled);
+		return true;
+	}
+
+	return false;
+}
+
+// The first reason wins
+void Solver::request_stop(SolveStatus reason) const
+{
+	int running = SolveStatus::Running;
+	this->stop_status.compare_exchange_strong(running, reason);
+}
+
+void Solver::count_valid(size_t count) const
+{
+	size_t total = this->valid_count.fetch_add(count) + count;
+	if (this->options.max_results > 0 && total >= this->options.max_results)
+	{
+		this->request_stop(SolveStatus::ResultLimitReached);
+	}
+}
+
+// Progress records are rare, the message is built unconditionally
+void Solver::log(LogLevel level, const std::string& what) const {
+	WHITERABBITHOLE_LOG(this->logger, level, what);
+}
+
+unsigned int Solver::get_thread_count() const
+{
+	if (this->options.thread_count > 0)
+	{
+		return this->options.thread_count;
+	}
+
+	unsigned int hardware_threads = std::thread::hardware_concurrency();
+	return hardware_threads > 0 ? hardware_threads : 1;
+}
+
+unsigned int Solver::get_hash_thread_count() const
+{
+	if (this->options.hash_thread_count > 0)
+	{
+		return this->options.hash_thread_count;
+	}
+
+	unsigned int half = this->get_thread_count() / 2;
+	return half > 0 ? half : 1;
+}
+
+unsigned int Solver::get_split_depth(unsigned int group_size) const
+{
+	unsigned int depth = this->options.split_depth;
+	if (depth == 0)
+	{
+		// One level is enough to keep all workers busy unless the vocabulary is tiny
+		depth = this->use_words->size() >= 64 * this->get_thread_count() ? 1 : 2;
+	}
+
+	// Tasks must still own a subtree
+	unsigned int max_depth = group_size > 1 ? group_size - 1 : 1;
+	return depth < max_depth ? depth : max_depth;
 }
 
 unsigned int Solver::get_disposition_count(unsigned int group_size) const
@@ -226,7 +717,7 @@ bool Solver::check_dbfile_path() const
 	return std::ifstream(this->dbfile_path).good();
 }
 
-void Solver::load_words()
+size_t Solver::load_words()
 {
 	if (!this->check_dbfile_path())
 	{
@@ -239,31 +730,30 @@ void Solver::load_words()
 		delete this->words;
 	}
 
-	std::ifstream dbfile(this->dbfile_path);
-	if (!dbfile.is_open())
+	// The file is scanned in place: only the words made of the phrase letters are copied out
+	MappedFile dbfile(this->dbfile_path);
+	std::vector<word_view_t> views;
+	size_t loaded_count = this->anagram_phrase_filter->scan_lines(dbfile.get_data(), dbfile.get_size(), &views);
+	if (loaded_count == 0)
 	{
-		throw std::exception("Could not open dbfile");
+		throw std::exception("No words available, cannot proceed processing words");
 	}
 
 	this->words = new wordset_t();
-
-	std::string line;
-	while (std::getline(dbfile, line))
+	this->words->reserve(views.size());
+	for (std::vector<word_view_t>::const_iterator it = views.begin(); it != views.end(); it++)
 	{
-		if (line.length() == 0)
-		{
-			continue;
-		}
-		this->words->push_back(line);
+		this->words->push_back(std::string(dbfile.get_data() + it->offset, it->length));
 	}
 
-	dbfile.close();
+	return loaded_count;
 }
 
 void Solver::process_words()
 {
-	// In order to proceed, we need the word set to be filled
-	if (!this->words || this->words->size() == 0)
+	// In order to proceed, we need the word set to be loaded (it is empty when no word fits
+	// the phrase letters, there are no usewords then)
+	if (!this->words)
 	{
 		throw std::exception("No words available, cannot proceed processing words");
 	}
@@ -281,6 +771,10 @@ void Solver::process_words()
 	// Keep track of added words to avoid duplicates
 	std::unordered_map<std::string, bool> use_words_map;
 
+	// Anagrams of each other (same sorted letters) form a class
+	std::unordered_map<std::string, unsigned int> class_ids;
+	std::vector<usewordset_t> classes;
+
 	// For each word, include it in use_words only if all its characters
 	// are contained in the anagram phrase
 	for (wordset_t::const_iterator it = this->words->begin(); it != this->words->end(); it++)
@@ -295,10 +789,20 @@ void Solver::process_words()
 		// Not a duplicate => Consider it
 		if (this->accept_word(*it))
 		{
-			this->use_words->push_back(*it);
-
-			// Process the word to extract its symbols and add them to the alphabet
-			for (size_t i = 0, l = it->length(); i < l; i++)
+			std::string signature = this->get_word_signature(*it);
+			std::unordered_map<std::string, unsigned int>::const_iterator class_it = class_ids.find(signature);
+			if (class_it == class_ids.end())
+			{
+				class_ids[signature] = classes.size();
+				classes.push_back(usewordset_t(1, *it));
+			}
+			else
+			{
+				classes[class_it->second].push_back(*it);
+			}
+
+			// Process the word to extract its symbols and add them to the alphabet
+			for (size_t i = 0, l = it->length(); i < l; i++)
 			{
 				alphabet_map[it->at(i)] = true;
 			}
@@ -306,6 +810,189 @@ void Solver::process_words()
 	}
 	use_words_map.clear(); // Not needed anymore
 
+	// Letters of the phrase are ranked by the number of classes they appear in, the rarest first
+	// (then by symbol)
+	std::vector<size_t> letter_classes(256, 0);
+	for (std::vector<usewordset_t>::const_iterator it = classes.begin(); it != classes.end(); it++)
+	{
+		std::string letters = this->get_word_signature(it->front());
+		letters.erase(std::unique(letters.begin(), letters.end()), letters.end());
+		for (std::string::const_iterator letter = letters.begin(); letter != letters.end(); letter++)
+		{
+			letter_classes[(unsigned char)*letter]++;
+		}
+	}
+	if (this->use_words_rare_letters)
+	{
+		this->use_words_rare_letters->clear();
+		delete this->use_words_rare_letters;
+	}
+	this->use_words_rare_letters = new std::vector<char>();
+	for (std::string::const_iterator it = this->anagram_phrase.begin(); it != this->anagram_phrase.end(); it++)
+	{
+		if (*it != ' ' && std::find(this->use_words_rare_letters->begin(), this->use_words_rare_letters->end(), *it) ==
+			this->use_words_rare_letters->end())
+		{
+			this->use_words_rare_letters->push_back(*it);
+		}
+	}
+	std::sort(this->use_words_rare_letters->begin(), this->use_words_rare_letters->end(),
+		[&](char letter1, char letter2)
+		{
+			size_t classes1 = letter_classes[(unsigned char)letter1];
+			size_t classes2 = letter_classes[(unsigned char)letter2];
+			return classes1 != classes2 ? classes1 < classes2 : (unsigned char)letter1 < (unsigned char)letter2;
+		});
+	std::vector<size_t> letter_ranks(256, this->use_words_rare_letters->size());
+	for (size_t i = 0; i < this->use_words_rare_letters->size(); i++)
+	{
+		letter_ranks[(unsigned char)(*(this->use_words_rare_letters))[i]] = i;
+	}
+
+	// Usewords are laid out class after class, by rarest letter, then shortest classes first (then in
+	// order of first appearance), so that words of the same rarest letter and length form a bucket,
+	// and the classes of a rarest letter are also indexed by a trie.
+	// Every useword knows where its class ends and every class where it begins
+	std::vector<std::pair<size_t, size_t>> class_keys; // Rank of the rarest letter, length
+	for (std::vector<usewordset_t>::const_iterator it = classes.begin(); it != classes.end(); it++)
+	{
+		size_t rank = this->use_words_rare_letters->size();
+		for (std::string::const_iterator letter = it->front().begin(); letter != it->front().end(); letter++)
+		{
+			rank = std::min(rank, letter_ranks[(unsigned char)*letter]);
+		}
+		class_keys.push_back(std::make_pair(rank, it->front().length()));
+	}
+	std::vector<unsigned int> class_order(classes.size());
+	for (unsigned int i = 0; i < class_order.size(); i++)
+	{
+		class_order[i] = i;
+	}
+	std::stable_sort(class_order.begin(), class_order.end(),
+		[&](unsigned int class1, unsigned int class2) { return class_keys[class1] < class_keys[class2]; });
+	if (this->use_words_class_ends)
+	{
+		this->use_words_class_ends->clear();
+		delete this->use_words_class_ends;
+	}
+	if (this->use_words_class_begins)
+	{
+		this->use_words_class_begins->clear();
+		delete this->use_words_class_begins;
+	}
+	if (this->use_words_letter_buckets)
+	{
+		this->use_words_letter_buckets->clear();
+		delete this->use_words_letter_buckets;
+	}
+	if (this->use_words_letter_tries)
+	{
+		this->use_words_letter_tries->clear();
+		delete this->use_words_letter_tries;
+	}
+	this->use_words_class_ends = new std::vector<unsigned int>();
+	this->use_words_class_begins = new std::unordered_map<std::string, unsigned int>();
+	this->use_words_letter_buckets = new std::vector<std::vector<letter_bucket_t>>(256);
+	std::vector<std::vector<word_trie_entry_t>> letter_entries(256);
+	for (std::vector<unsigned int>::const_iterator it = class_order.begin(); it != class_order.end(); it++)
+	{
+		const usewordset_t& word_class = classes[*it];
+		unsigned int class_begin = this->use_words->size();
+		unsigned int class_end = class_begin + word_class.size();
+		(*(this->use_words_class_begins))[this->get_word_signature(word_class.front())] = class_begin;
+		this->use_words->insert(this->use_words->end(), word_class.begin(), word_class.end());
+		this->use_words_class_ends->insert(this->use_words_class_ends->end(), word_class.size(), class_end);
+
+		// Words with no letter to rank (spaces only) never fit the letters of the phrase
+		size_t rank = class_keys[*it].first;
+		if (rank == this->use_words_rare_letters->size()) continue;
+		unsigned char letter = (unsigned char)(*(this->use_words_rare_letters))[rank];
+		std::vector<letter_bucket_t>& buckets = (*(this->use_words_letter_buckets))[letter];
+		if (buckets.empty() || buckets.back().length != class_keys[*it].second)
+		{
+			letter_bucket_t bucket = { class_keys[*it].second, class_begin, class_end };
+			buckets.push_back(bucket);
+		}
+		buckets.back().end = class_end;
+		word_trie_entry_t entry = { this->get_word_signature(word_class.front()), class_begin, class_end };
+		letter_entries[letter].push_back(entry);
+	}
+	this->use_words_letter_tries = new std::vector<WordTrie>();
+	for (size_t i = 0; i < letter_entries.size(); i++)
+	{
+		this->use_words_letter_tries->push_back(WordTrie(letter_entries[i]));
+	}
+
+	// Usewords per length, to plan the lengths of the combinations
+	if (this->use_words_length_counts)
+	{
+		this->use_words_length_counts->clear();
+		delete this->use_words_length_counts;
+	}
+	this->use_words_length_counts = new std::map<size_t, unsigned int>();
+	for (usewordset_t::const_iterator it = this->use_words->begin(); it != this->use_words->end(); it++)
+	{
+		(*(this->use_words_length_counts))[it->length()]++;
+	}
+
+	// Letter counts of the usewords are computed once, the search charges them against the phrase:
+	// packed signatures when the phrase fits the layout, histograms otherwise
+	if (this->use_words_histos)
+	{
+		this->use_words_histos->clear();
+		delete this->use_words_histos;
+	}
+	if (this->use_words_signatures)
+	{
+		this->use_words_signatures->clear();
+		delete this->use_words_signatures;
+	}
+	if (this->use_words_signature_classes)
+	{
+		this->use_words_signature_classes->clear();
+		delete this->use_words_signature_classes;
+	}
+	this->use_words_histos = new std::vector<Histogram>();
+	this->use_words_signatures = new std::vector<letter_signature_t>();
+	this->use_words_signature_classes =
+		new std::unordered_map<letter_signature_t, unsigned int, letter_signature_hash_t, letter_signature_equal_t>();
+	if (this->anagram_phrase_layout->is_packable())
+	{
+		this->use_words_signatures->resize(this->use_words->size());
+		for (size_t i = 0; i < this->use_words->size(); i++)
+		{
+			const std::string& word = (*(this->use_words))[i];
+			this->anagram_phrase_layout->get_signature(word.c_str(), word.length(), &(*(this->use_words_signatures))[i]);
+		}
+		for (unsigned int i = 0; i < this->use_words->size(); i = this->get_next_combination_child(i))
+		{
+			(*(this->use_words_signature_classes))[(*(this->use_words_signatures))[i]] = i;
+		}
+	}
+	else
+	{
+		this->use_words_histos->reserve(this->use_words->size());
+		for (usewordset_t::const_iterator it = this->use_words->begin(); it != this->use_words->end(); it++)
+		{
+			this->use_words_histos->push_back(Histogram(*it));
+		}
+	}
+
+	// Word length bounds are used to prune the search
+	this->use_words_min_length = 0;
+	this->use_words_max_length = 0;
+	for (usewordset_t::const_iterator it = this->use_words->begin(); it != this->use_words->end(); it++)
+	{
+		if (this->use_words_min_length == 0 || it->length() < this->use_words_min_length)
+		{
+			this->use_words_min_length = it->length();
+		}
+		if (it->length() > this->use_words_max_length)
+		{
+			this->use_words_max_length = it->length();
+		}
+	}
+
 	// Check the alphabet has not previously created, in which case delete
 	if (this->alphabet)
 	{
@@ -320,176 +1007,1303 @@ void Solver::process_words()
 	}
 }
 
-std::vector<std::string> Solver::get_words_in_phrase(const std::string& phrase) const
+std::vector<std::string> Solver::get_words_in_phrase(const std::string& phrase) const
+{
+	size_t pos = 0;
+	std::string word;
+	std::string s = phrase;
+	std::string delimiter = " ";
+	std::vector<std::string> result;
+	while ((pos = s.find(delimiter)) != std::string::npos) {
+		word = s.substr(0, pos);
+		result.push_back(word);
+		s.erase(0, pos + delimiter.length());
+	}
+
+	return result;
+}
+
+// Anagrams share the signature: the letters of the word in ascending order
+std::string Solver::get_word_signature(const std::string& word) const
+{
+	std::string signature = word;
+	std::sort(signature.begin(), signature.end());
+	return signature;
+}
+
+bool Solver::accept_word(const std::string& word) const
+{
+	// Check that every character in the word is present in the anagram phrase
+	if (!this->anagram_phrase_filter->accept(word.c_str(), word.length()))
+	{
+		return false;
+	}
+
+	// If the character check passes, then consider the letter counts
+	if (this->anagram_phrase_layout->is_packable())
+	{
+		letter_signature_t signature;
+		return this->anagram_phrase_layout->get_signature(word.c_str(), word.length(), &signature) &&
+			this->anagram_phrase_layout->contains(this->anagram_phrase_layout->get_phrase_signature(), signature);
+	}
+	return *(this->anagram_phrase_histo) >= Histogram(word);
+}
+
+unsigned int Solver::get_phrase_words_count() const
+{
+	return std::count(
+		this->anagram_phrase.begin(),
+		this->anagram_phrase.end(),
+		' ') + 1;
+}
+
+unsigned int Solver::get_phrase_char_count() const
+{
+	return this->anagram_phrase.length();
+}
+
+void Solver::search_candidates(unsigned int group_size, result_t* result, bool walkCombinationsOnly,
+	DispositionsTreeWalkState::candidate_queue_t* candidate_queue) const
+{
+	// Only the combinations whose word lengths add up to the phrase are walked: one length plan
+	// after the other
+	std::vector<length_plan_t> plans;
+	if (walkCombinationsOnly)
+	{
+		plans = this->get_length_plans(group_size);
+		this->log(LogLevel::Info, "Length plans: " + std::to_string(plans.size()));
+	}
+
+	// The nodes at split depth become the tasks, each one walks its own subtree. Tasks are the unit
+	// of progress (for stats and checkpoints): even on one thread, the pool then runs them inline
+	// A resumed phase 1 is split as it was saved, whatever the threads now
+	unsigned int split_depth = this->get_split_depth(group_size);
+	if (this->checkpoint && this->checkpoint->get_phase() == 1 && this->checkpoint->get_split_depth() > 0)
+	{
+		split_depth = this->checkpoint->get_split_depth();
+	}
+	std::vector<DispositionsTreeWalkState::disposition_t> prefixes;
+	std::vector<size_t> prefix_plans;
+	DispositionsTreeWalkState* state = new DispositionsTreeWalkState();
+	state->set_budget(this->anagram_phrase, this->anagram_phrase_layout);
+	if (walkCombinationsOnly)
+	{
+		for (size_t i = 0; i < plans.size(); i++)
+		{
+			state->set_plan(&(plans[i]));
+			this->collect_prefixes(*(this->use_words), group_size, split_depth, state, &prefixes,
+				walkCombinationsOnly);
+			prefix_plans.resize(prefixes.size(), i);
+		}
+	}
+	else
+	{
+		this->collect_prefixes(*(this->use_words), group_size, split_depth, state, &prefixes,
+			walkCombinationsOnly);
+	}
+	delete state;
+	this->log(LogLevel::Info, "Running " + std::to_string(prefixes.size()) + " tasks on " +
+		std::to_string(this->get_thread_count()) + " threads");
+	if (this->checkpoint)
+	{
+		this->checkpoint->set_split_depth(split_depth);
+		this->checkpoint->start_phase(1, prefixes.size());
+	}
+	this->stats->start_phase(1, prefixes.size(), this->checkpoint ? this->checkpoint->get_completed_count() : 0);
+
+	this->run_walk_tasks(prefixes.size(),
+		[&](size_t task, unsigned int /*worker*/, const DispositionsTreeWalkState* state, result_t* result)
+		{
+			const DispositionsTreeWalkState::disposition_t& prefix = prefixes[task];
+			state->set_plan(walkCombinationsOnly ? &(plans[prefix_plans[task]]) : 0);
+			for (size_t i = 0; i < prefix.size(); i++)
+			{
+				this->push_word(*(this->use_words), group_size, state, prefix[i]); // Prefixes are feasible
+			}
+			if (walkCombinationsOnly)
+			{
+				this->walk_combinations(*(this->use_words), group_size, state, result);
+			}
+			else
+			{
+				this->walk_dispositions(*(this->use_words), group_size, state, result, walkCombinationsOnly);
+			}
+			for (size_t i = 0; i < prefix.size(); i++)
+			{
+				this->pop_word(*(this->use_words), state);
+			}
+		},
+		result, true, candidate_queue);
+}
+
+// Phase 1 runs on the worker threads and pushes every candidate to a bounded queue, the hashing
+// threads pop them and verify their permutations right away. A full queue holds the search back.
+// Valid phrases are sorted since their order depends on scheduling.
+void Solver::search_pipelined(unsigned int group_size, result_t* result, size_t* candidates_count) const
+{
+	DispositionsTreeWalkState::candidate_queue_t queue(pipeline_queue_capacity);
+	std::atomic<bool> search_done(false);
+	std::atomic<size_t> popped_count(0);
+
+	unsigned int hashers_count = this->get_hash_thread_count();
+	std::vector<result_t> buffers(hashers_count);
+	std::vector<std::exception_ptr> errors(hashers_count);
+
+	std::vector<std::thread> hashers;
+	for (unsigned int i = 0; i < hashers_count; i++)
+	{
+		hashers.push_back(std::thread([&, i]()
+		{
+			PermutationBatch batch(group_size, this->get_phrase_char_count(), permutation_batch_size);
+			batch.counters = this->stats->get_counters(this->get_thread_count() + i);
+			phrase_t candidate;
+			unsigned int attempt = 0;
+			while (true)
+			{
+				// Once the search is over, an empty queue stays empty
+				bool drained = search_done.load();
+				if (queue.try_pop(&candidate))
+				{
+					size_t index = popped_count.fetch_add(1);
+					attempt = 0;
+
+					// After a failure or a stop candidates are still drained, so that the search never blocks
+					if (errors[i] || this->is_stop_requested()) continue;
+					try
+					{
+						WHITERABBITHOLE_LOG(this->logger, LogLevel::Debug, "Running dispositions on combination: " +
+							phrase_to_string(candidate) + " - " + std::to_string(index + 1));
+						this->verify_combination(candidate, &batch, &(buffers[i]));
+					}
+					catch (...)
+					{
+						errors[i] = std::current_exception();
+					}
+				}
+				else if (drained)
+				{
+					break;
+				}
+				else
+				{
+					DispositionsTreeWalkState::candidate_queue_t::back_off(attempt++);
+				}
+			}
+		}));
+	}
+
+	// Stop the hashers even if the search fails
+	std::exception_ptr search_error;
+	try
+	{
+		result_t unqueued;
+		this->search_candidates(group_size, &unqueued, true, &queue);
+	}
+	catch (...)
+	{
+		search_error = std::current_exception();
+	}
+	search_done.store(true);
+
+	for (std::vector<std::thread>::iterator it = hashers.begin(); it != hashers.end(); it++)
+	{
+		it->join();
+	}
+
+	if (search_error)
+	{
+		std::rethrow_exception(search_error);
+	}
+	for (unsigned int i = 0; i < hashers_count; i++)
+	{
+		if (errors[i]) std::rethrow_exception(errors[i]);
+		result->insert(result->end(), buffers[i].begin(), buffers[i].end());
+	}
+	std::sort(result->begin(), result->end());
+
+	*candidates_count = popped_count.load();
+}
+
+// Every permutation of a candidate has its length and letters: the phrases are only hashed
+void Solver::search_valid_dispositions(const result_t& combinations, unsigned int group_size,
+	result_t* result) const
+{
+	size_t combinations_size = combinations.size();
+
+	// One batch per worker
+	unsigned int workers_count = this->get_thread_count();
+	std::vector<PermutationBatch*> batches;
+	for (unsigned int i = 0; i < workers_count; i++)
+	{
+		batches.push_back(new PermutationBatch(group_size, this->get_phrase_char_count(), permutation_batch_size));
+		batches.back()->counters = this->stats->get_counters(i);
+	}
+
+	walk_task_t task_body = [&](size_t task, unsigned int worker, const DispositionsTreeWalkState* /*state*/,
+		result_t* result)
+	{
+		if (this->is_stop_requested())
+		{
+			return;
+		}
+
+		WHITERABBITHOLE_LOG(this->logger, LogLevel::Debug, "Running dispositions on combination: " +
+			phrase_to_string(combinations[task]) + " - " + std::to_string(task + 1) + "/" +
+			std::to_string(combinations_size));
+
+		this->verify_combination(combinations[task], batches[worker], result);
+	};
+
+	if (this->checkpoint)
+	{
+		this->checkpoint->start_phase(2, combinations_size);
+		std::map<size_t, std::vector<phrase_t>> restored = this->checkpoint->get_outputs();
+		for (std::map<size_t, std::vector<phrase_t>>::const_iterator it = restored.begin(); it != restored.end(); it++)
+		{
+			this->count_valid(it->second.size());
+		}
+	}
+	this->stats->start_phase(2, combinations_size, this->checkpoint ? this->checkpoint->get_completed_count() : 0);
+	this->stats->start_hashing();
+
+	this->run_walk_tasks(combinations_size, task_body, result, false);
+
+	for (unsigned int i = 0; i < workers_count; i++)
+	{
+		delete batches[i];
+	}
+}
+
+// The combination stands for all the combinations of the anagrams of its words
+void Solver::verify_combination(const phrase_t& combination, PermutationBatch* batch, result_t* result) const
+{
+	std::vector<phrase_t> expanded;
+	this->expand_combination(combination, &expanded);
+	for (std::vector<phrase_t>::const_iterator it = expanded.begin();
+		it != expanded.end() && !this->is_stop_requested();
+		it++)
+	{
+		this->verify_permutations(*it, batch, result);
+	}
+}
+
+// Permutations come from Heap's algorithm, one swap apart. Engine slot i is written at phrase
+// position m - 1 - i: the frequent swaps of the low slots touch the end of the phrase, which
+// is the only part rewritten. A single-block phrase is queued as the words of its block holding
+// phrase bytes, the padding and length words of the queue never change
+void Solver::verify_permutations(const phrase_t& words, PermutationBatch* batch, result_t* result) const
+{
+	size_t words_count = words.size();
+	batch->engine.reset();
+	this->write_permutation_phrase(words, 0, batch);
+
+	size_t first_swapped, second_swapped;
+	do
+	{
+		size_t slot = batch->count++;
+		if (batch->words)
+		{
+			for (size_t k = 0; k < batch->message_words; k++)
+			{
+				batch->words[k * batch->words_stride + slot] = batch->block[k];
+			}
+		}
+		else
+		{
+			memcpy(batch->phrases + slot * (batch->phrase_length + 1), batch->phrase, batch->phrase_length);
+		}
+		memcpy(batch->permutations + slot * words_count, batch->engine.get_permutation(),
+			words_count * sizeof(unsigned int));
+
+		if (batch->count == batch->capacity)
+		{
+			// Stop requests are polled once per batch
+			this->flush_permutation_batch(words, batch, result);
+			if (this->is_stop_requested())
+			{
+				return;
+			}
+		}
+
+		if (!batch->engine.next(&first_swapped, &second_swapped))
+		{
+			break;
+		}
+
+		size_t last_swapped = first_swapped > second_swapped ? first_swapped : second_swapped;
+		this->write_permutation_phrase(words, words_count - 1 - last_swapped, batch);
+	} while (true);
+
+	this->flush_permutation_batch(words, batch, result);
+}
+
+void Solver::write_permutation_phrase(const phrase_t& words, size_t from_position,
+	PermutationBatch* batch) const
+{
+	size_t words_count = words.size();
+	const unsigned int* permutation = batch->engine.get_permutation();
+	for (size_t position = from_position; position < words_count; position++)
+	{
+		const std::string& word = words[permutation[words_count - 1 - position]];
+		char* dest = batch->phrase + batch->offsets[position];
+		memcpy(dest, word.data(), word.length());
+		if (position + 1 < words_count)
+		{
+			dest[word.length()] = ' ';
+			batch->offsets[position + 1] = batch->offsets[position] + word.length() + 1;
+		}
+	}
+}
+
+void Solver::flush_permutation_batch(const phrase_t& words, PermutationBatch* batch, result_t* result) const
+{
+	if (batch->count == 0)
+	{
+		return;
+	}
+
+	size_t words_count = words.size();
+	if (batch->counters) SearchCounters::add(batch->counters->hashes_computed, batch->count);
+	size_t matches_count = batch->words ?
+		this->phrase_verifier->match_words(batch->words, batch->words_stride, batch->count, batch->targets) :
+		this->phrase_verifier->match(batch->messages, batch->count, batch->targets);
+	if (matches_count > 0)
+	{
+		for (size_t i = 0; i < batch->count; i++)
+		{
+			if (batch->targets[i] < 0) continue;
+
+			const unsigned int* permutation = batch->permutations + i * words_count;
+			phrase_t valid_phrase;
+			DispositionsTreeWalkState::disposition_t disposition;
+			for (size_t position = 0; position < words_count; position++)
+			{
+				valid_phrase.push_back(words[permutation[words_count - 1 - position]]);
+				disposition.push_back(permutation[words_count - 1 - position]);
+			}
+			result->push_back(valid_phrase);
+			this->count_valid(1);
+
+			WHITERABBITHOLE_LOG(this->logger, LogLevel::Info, "Disposition: " +
+				DispositionsTreeWalkState::get_disposition_words_str(disposition, words) + " - " +
+				disposition_to_string(disposition));
+			WHITERABBITHOLE_LOG(this->logger, LogLevel::Info, "|- Valid => !!FOUND ONE!! (" +
+				this->phrase_hashes[batch->targets[i]] + ")");
+		}
+	}
+
+	batch->count = 0;
+}
+
+// Phase 1 only takes the first members of an anagram class (a class taken k times stands for
+// its first k words): every k-subset of each class is substituted back.
+// Example: classes = [stout, touts], [pints] and combination = [stout, pints]
+// => [stout, pints], [touts, pints]
+void Solver::expand_combination(const phrase_t& combination, std::vector<phrase_t>* expanded) const
+{
+	// Class begin and number of words taken from it
+	std::vector<std::pair<unsigned int, unsigned int>> classes;
+	for (phrase_t::const_iterator it = combination.begin(); it != combination.end(); it++)
+	{
+		unsigned int class_begin = this->use_words_class_begins->at(this->get_word_signature(*it));
+		std::vector<std::pair<unsigned int, unsigned int>>::iterator class_it = classes.begin();
+		while (class_it != classes.end() && class_it->first != class_begin) class_it++;
+
+		if (class_it == classes.end()) classes.push_back(std::make_pair(class_begin, 1u));
+		else class_it->second++;
+	}
+
+	expanded->clear();
+	phrase_t phrase;
+	this->expand_classes(classes, 0, 0, classes.front().first, &phrase, expanded);
+}
+
+void Solver::expand_classes(
+	const std::vector<std::pair<unsigned int, unsigned int>>& classes,
+	size_t class_index,
+	unsigned int taken,
+	unsigned int from,
+	phrase_t* phrase,
+	std::vector<phrase_t>* expanded) const
+{
+	if (class_index == classes.size())
+	{
+		expanded->push_back(*phrase);
+		return;
+	}
+
+	unsigned int count = classes[class_index].second;
+	if (taken == count)
+	{
+		unsigned int next_from = class_index + 1 < classes.size() ? classes[class_index + 1].first : 0;
+		this->expand_classes(classes, class_index + 1, 0, next_from, phrase, expanded);
+		return;
+	}
+
+	// Leave room for the words of the class still to take
+	unsigned int class_end = this->use_words_class_ends->at(classes[class_index].first);
+	for (unsigned int i = from; i + (count - taken) <= class_end; i++)
+	{
+		phrase->push_back(this->use_words->at(i));
+		this->expand_classes(classes, class_index, taken + 1, i + 1, phrase, expanded);
+		phrase->pop_back();
+	}
+}
+
+// Every worker owns a walk state and a result buffer. Results are tagged by the task that
+// produced them and merged in task order, so the outcome does not depend on scheduling.
+// With a checkpoint, tasks done before are skipped and their saved output is merged instead.
+void Solver::run_walk_tasks(size_t task_count, const walk_task_t& task, result_t* result,
+	bool use_budget, DispositionsTreeWalkState::candidate_queue_t* candidate_queue) const
+{
+	struct TaskSegment { size_t task; const result_t* source; size_t begin; size_t end; };
+
+	WorkStealingPool pool(this->get_thread_count());
+	unsigned int workers_count = pool.get_thread_count();
+	std::vector<DispositionsTreeWalkState*> states;
+	std::vector<TranspositionTable*> tables;
+	std::vector<result_t> buffers(workers_count);
+	std::vector<std::vector<TaskSegment>> segments(workers_count);
+	for (unsigned int i = 0; i < workers_count; i++)
+	{
+		states.push_back(new DispositionsTreeWalkState());
+		if (use_budget) states.back()->set_budget(this->anagram_phrase, this->anagram_phrase_layout);
+		states.back()->set_candidate_queue(candidate_queue);
+		states.back()->set_counters(this->stats->get_counters(i));
+
+		// Dead nodes are keyed on the packed letters left, and stay valid across the tasks of a worker
+		if (use_budget && this->anagram_phrase_layout->is_packable() && this->options.transposition_table_size > 0)
+		{
+			tables.push_back(new TranspositionTable(this->options.transposition_table_size));
+			states.back()->set_transposition_table(tables.back());
+		}
+	}
+
+	std::map<size_t, std::vector<phrase_t>> restored;
+	if (this->checkpoint)
+	{
+		restored = this->checkpoint->get_outputs();
+	}
+
+	pool.run(task_count, [&](size_t task_index, unsigned int worker)
+	{
+		if (this->checkpoint)
+		{
+			if (this->checkpoint->is_task_completed(task_index) || this->is_stop_requested()) return;
+			this->checkpoint->begin_task(worker, task_index);
+		}
+
+		result_t* buffer = &(buffers[worker]);
+		TaskSegment segment = { task_index, buffer, buffer->size(), 0 };
+		task(task_index, worker, states[worker], buffer);
+		segment.end = buffer->size();
+		if (segment.end > segment.begin)
+		{
+			segments[worker].push_back(segment);
+		}
+
+		// A stopped task may be partial: it is not counted, and runs again on resume
+		if (this->is_stop_requested())
+		{
+			return;
+		}
+		this->stats->complete_task();
+		if (this->checkpoint)
+		{
+			this->checkpoint->complete_task(worker, task_index,
+				buffer->begin() + segment.begin, buffer->begin() + segment.end);
+			this->checkpoint->save_if_due();
+		}
+	});
+
+	for (unsigned int i = 0; i < workers_count; i++)
+	{
+		delete states[i];
+	}
+	for (size_t i = 0; i < tables.size(); i++)
+	{
+		delete tables[i];
+	}
+
+	// Deterministic merge
+	std::vector<TaskSegment> order;
+	for (unsigned int i = 0; i < workers_count; i++)
+	{
+		order.insert(order.end(), segments[i].begin(), segments[i].end());
+	}
+	for (std::map<size_t, std::vector<phrase_t>>::const_iterator it = restored.begin(); it != restored.end(); it++)
+	{
+		TaskSegment segment = { it->first, &(it->second), 0, it->second.size() };
+		order.push_back(segment);
+	}
+	std::sort(order.begin(), order.end(),
+		[](const TaskSegment& s1, const TaskSegment& s2) { return s1.task < s2.task; });
+	for (std::vector<TaskSegment>::const_iterator it = order.begin(); it != order.end(); it++)
+	{
+		result->insert(result->end(),
+			it->source->begin() + it->begin,
+			it->source->begin() + it->end);
+	}
+}
+
+void Solver::collect_prefixes(
+	const usewordset_t& usewordset,
+	unsigned int group_size,
+	unsigned int depth,
+	const DispositionsTreeWalkState* state,
+	std::vector<DispositionsTreeWalkState::disposition_t>* prefixes,
+	bool walkCombinationsOnly) const
+{
+	if (state->get_disposition()->size() == depth)
+	{
+		prefixes->push_back(*(state->get_disposition()));
+		return;
+	}
+
+	if (walkCombinationsOnly)
+	{
+		unsigned int first;
+		char letter = this->get_combination_letter(state, &first);
+		this->visit_combination_children(usewordset, group_size, state->get_disposition()->size(), state, letter, first,
+			[&](unsigned int index)
+		{
+			if (!this->push_word(usewordset, group_size, state, index)) return;
+			this->collect_prefixes(usewordset, group_size, depth, state, prefixes, walkCombinationsOnly);
+			this->pop_word(usewordset, state);
+		});
+
+		return;
+	}
+
+	DispositionsTreeWalkState::disposition_t residuals =
+		this->get_residual_indices(usewordset, *(state->get_disposition()));
+
+	for (
+		DispositionsTreeWalkState::disposition_t::const_iterator it = residuals.begin();
+		it != residuals.end();
+		it++)
+	{
+		if (!this->push_word(usewordset, group_size, state, *it)) continue;
+		this->collect_prefixes(usewordset, group_size, depth, state, prefixes, walkCombinationsOnly);
+		this->pop_word(usewordset, state);
+	}
+}
+
+// Returns false when the subtree is known to hold no candidate (true when it does, or when the
+// walk was stopped before it could tell)
+bool Solver::walk_dispositions(
+	const usewordset_t& usewordset,
+	unsigned int group_size,
+	const DispositionsTreeWalkState* state,
+	result_t* result,
+	bool walkCombinationsOnly) const
+{
+	SearchCounters* counters = state->get_counters();
+	if (counters) SearchCounters::add(counters->nodes_visited);
+
+	if (state->get_disposition()->size() == group_size)
+	{
+		// Process this disposition as this is a complete disposition (leaf in the recursion-tree)
+		return this->evaluate_disposition(usewordset, group_size, state, result, walkCombinationsOnly);
+	}
+
+	if (walkCombinationsOnly)
+	{
+		return this->walk_combination_node(usewordset, group_size, state->get_disposition()->size(), state,
+			[&]() { return this->walk_dispositions(usewordset, group_size, state, result, walkCombinationsOnly); });
+	}
+
+	// Stop requests are polled at inner nodes only
+	if (this->is_stop_requested())
+	{
+		return true;
+	}
+
+	// A valid disposition has to be created as state contains an incomplete one
+	// Get residual array: all the indices not contained in state->disposition
+	DispositionsTreeWalkState::disposition_t residuals =
+		this->get_residual_indices(usewordset, *(state->get_disposition()));
+	bool found = false;
+
+	for (
+		DispositionsTreeWalkState::disposition_t::const_iterator it = residuals.begin();
+		it != residuals.end();
+		it++)
+	{
+		// Add the residual to the disposition (unless its subtree is cut)
+		if (!this->push_word(usewordset, group_size, state, *it))
+		{
+			if (counters) SearchCounters::add(counters->subtrees_pruned);
+			continue;
+		}
+
+		// Recursively process the new disposition
+		found |= this->walk_dispositions(usewordset, group_size, state, result, walkCombinationsOnly);
+
+		// Remove the residual as not needed anymore
+		this->pop_word(usewordset, state);
+	}
+
+	return found;
+}
+
+// Same walk as walk_dispositions with walkCombinationsOnly. Phrases of up to 8 words (most of
+// them) are walked by a kernel specialized on their word count, the longer ones by walk_dispositions
+bool Solver::walk_combinations(
+	const usewordset_t& usewordset,
+	unsigned int group_size,
+	const DispositionsTreeWalkState* state,
+	result_t* result) const
+{
+	switch (group_size)
+	{
+	case 1: return this->enter_combinations_kernel<1, 0>(usewordset, state, result, std::false_type());
+	case 2: return this->enter_combinations_kernel<2, 0>(usewordset, state, result, std::false_type());
+	case 3: return this->enter_combinations_kernel<3, 0>(usewordset, state, result, std::false_type());
+	case 4: return this->enter_combinations_kernel<4, 0>(usewordset, state, result, std::false_type());
+	case 5: return this->enter_combinations_kernel<5, 0>(usewordset, state, result, std::false_type());
+	case 6: return this->enter_combinations_kernel<6, 0>(usewordset, state, result, std::false_type());
+	case 7: return this->enter_combinations_kernel<7, 0>(usewordset, state, result, std::false_type());
+	case 8: return this->enter_combinations_kernel<8, 0>(usewordset, state, result, std::false_type());
+	default: return this->walk_dispositions(usewordset, group_size, state, result, true);
+	}
+}
+
+// The kernel is entered at the depth of the prefix already placed: the size is only checked here,
+// once per walk
+template <unsigned int GroupSize, unsigned int Depth>
+bool Solver::enter_combinations_kernel(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState* state,
+	result_t* result,
+	std::false_type) const
+{
+	if (state->get_disposition()->size() > Depth)
+	{
+		return this->enter_combinations_kernel<GroupSize, Depth + 1>(usewordset, state, result,
+			std::integral_constant<bool, Depth + 1 == GroupSize>());
+	}
+
+	return this->walk_combinations_kernel<GroupSize, Depth>(usewordset, state, result, std::false_type());
+}
+
+template <unsigned int GroupSize, unsigned int Depth>
+bool Solver::enter_combinations_kernel(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState* state,
+	result_t* result,
+	std::true_type) const
+{
+	return this->walk_combinations_kernel<GroupSize, Depth>(usewordset, state, result, std::true_type());
+}
+
+// An inner node of depth Depth: every depth is its own function, so that the recursion unrolls into
+// GroupSize nested loops and the depth, the slots left and the children buffer are constants
+template <unsigned int GroupSize, unsigned int Depth>
+bool Solver::walk_combinations_kernel(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState* state,
+	result_t* result,
+	std::false_type) const
+{
+	SearchCounters* counters = state->get_counters();
+	if (counters) SearchCounters::add(counters->nodes_visited);
+
+	// The last word uses up the letters left: its class is looked up instead of searched for
+	if (GroupSize - Depth == 1 && state->get_residual_signature())
+	{
+		unsigned int index;
+		if (this->is_stop_requested())
+		{
+			return true;
+		}
+		if (!this->get_last_combination_child(usewordset, state, &index))
+		{
+			return false;
+		}
+		if (!this->push_word(usewordset, GroupSize, state, index))
+		{
+			if (counters) SearchCounters::add(counters->subtrees_pruned);
+			return false;
+		}
+
+		bool found = this->walk_combinations_kernel<GroupSize, Depth + 1>(usewordset, state, result,
+			std::integral_constant<bool, Depth + 1 == GroupSize>());
+		this->pop_word(usewordset, state);
+		return found;
+	}
+
+	return this->walk_combination_node(usewordset, GroupSize, Depth, state, [&]()
+	{
+		return this->walk_combinations_kernel<GroupSize, Depth + 1>(usewordset, state, result,
+			std::integral_constant<bool, Depth + 1 == GroupSize>());
+	});
+}
+
+template <unsigned int GroupSize, unsigned int Depth>
+bool Solver::walk_combinations_kernel(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState* state,
+	result_t* result,
+	std::true_type) const
+{
+	SearchCounters* counters = state->get_counters();
+	if (counters) SearchCounters::add(counters->nodes_visited);
+
+	return this->evaluate_disposition(usewordset, GroupSize, state, result, true);
+}
+
+// Combinations are generated directly as ascending sequences of indices: a child always starts
+// above its parent, so only the subsets of usewords are visited. Within an anagram class only the
+// first members are taken, the others are substituted back in phase 2. Children all hold the
+// rarest letter left (see visit_combination_children), each is walked by walk_child once pushed
+template <typename WalkChild>
+inline bool Solver::walk_combination_node(
+	const usewordset_t& usewordset,
+	unsigned int group_size,
+	size_t depth,
+	const DispositionsTreeWalkState* state,
+	WalkChild walk_child) const
+{
+	// Stop requests are polled at inner nodes only
+	if (this->is_stop_requested())
+	{
+		return true;
+	}
+
+	SearchCounters* counters = state->get_counters();
+	unsigned int first;
+	unsigned long long pruned = 0; // Counted once per node, cuts are the hottest path
+	char letter = this->get_combination_letter(state, &first);
+
+	// Different prefixes often leave the same letters to the same slots: a subtree found dead
+	// through one of them is skipped through the others. The last slot is a single scan of its
+	// bucket, not worth a probe
+	TranspositionTable* table = group_size - depth >= 2 ? state->get_transposition_table() : 0;
+	transposition_key_t key;
+	if (table && !this->get_plan_lengths_left_key(usewordset, state, &key.lengths))
+	{
+		table = 0;
+	}
+	if (table)
+	{
+		key.residual = *(state->get_residual_signature());
+		key.first = first;
+		key.slots_left = group_size - (uint32_t)depth;
+		bool hit = table->contains(key);
+		if (counters) SearchCounters::add(hit ? counters->transposition_hits : counters->transposition_misses);
+		if (hit)
+		{
+			return false;
+		}
+	}
+
+	bool found = false;
+	this->visit_combination_children(usewordset, group_size, depth, state, letter, first, [&](unsigned int index)
+	{
+		if (!this->push_word(usewordset, group_size, state, index)) // Subtree cut
+		{
+			pruned++;
+			return;
+		}
+		found |= walk_child();
+		this->pop_word(usewordset, state);
+	});
+	if (counters) SearchCounters::add(counters->subtrees_pruned, pruned);
+
+	if (table && !found && table->insert(key) && counters)
+	{
+		SearchCounters::add(counters->transposition_evictions);
+	}
+
+	return found;
+}
+
+// Returns false when the complete disposition is not a candidate
+bool Solver::evaluate_disposition(
+	const usewordset_t& usewordset,
+	unsigned int group_size,
+	const DispositionsTreeWalkState* state,
+	result_t* result,
+	bool walkCombinationsOnly) const
+{
+	SearchCounters* counters = state->get_counters();
+	if (counters) SearchCounters::add(counters->leaves_evaluated);
+
+	DispositionRunResult run_result =
+		this->run_disposition(usewordset, group_size, state, result, !walkCombinationsOnly);
+
+	// Only built when logged: candidates are debug records, the others trace records
+	LogLevel level = run_result == DispositionRunResult::Valid ? LogLevel::Info :
+		(run_result == DispositionRunResult::Candidate ? LogLevel::Debug : LogLevel::Trace);
+	WHITERABBITHOLE_LOG(this->logger, level, "Disposition: " +
+		DispositionsTreeWalkState::get_disposition_words_str(*(state->get_disposition()), usewordset) +
+		" - " + disposition_to_string(*(state->get_disposition())));
+
+	if (counters && run_result != DispositionRunResult::No && run_result != DispositionRunResult::Skipped)
+	{
+		SearchCounters::add(counters->candidates_found);
+		if (!walkCombinationsOnly) SearchCounters::add(counters->hashes_computed);
+	}
+
+	if (run_result == DispositionRunResult::Candidate)
+	{
+		WHITERABBITHOLE_LOG(this->logger, LogLevel::Debug, "|- Candidate");
+
+		if (walkCombinationsOnly && state->get_candidate_queue())
+		{
+			state->get_candidate_queue()->push(result->back());
+			result->pop_back();
+		}
+	}
+	else if (run_result == DispositionRunResult::Valid)
+	{
+		WHITERABBITHOLE_LOG(this->logger, LogLevel::Info, "|- Valid => !!FOUND ONE!!");
+	}
+	else if (run_result == DispositionRunResult::Skipped)
+	{
+		WHITERABBITHOLE_LOG(this->logger, LogLevel::Trace, "|- Skipped");
+	}
+
+	return run_result != DispositionRunResult::No;
+}
+
+Solver::DispositionRunResult Solver::run_disposition(
+	const usewordset_t& usewordset,
+	unsigned int group_size,
+	const DispositionsTreeWalkState* state,
+	result_t* result,
+	bool checkValid) const
+{
+	// Try the disposition
+	// 1. Check the letters first: with a budget, the words were charged on the way down and
+	//    the leaf was only reached if the letters left fit no more slots, i.e. none is left
+	// 2. If they match, write the try-phrase to the buffer of the state and move to the hash
+	//    check: words are only copied when the phrase is recorded
+	const DispositionsTreeWalkState::disposition_t& disposition = *(state->get_disposition());
+	DispositionRunResult run_result = DispositionRunResult::No;
+	if (state->has_budget() ? state->get_residual_length() != 0 :
+		!this->is_disposition_candidate(usewordset, disposition))
+	{
+		return run_result;
+	}
+
+	// Candidate, proceed with hash check
+	run_result = DispositionRunResult::Candidate;
+	if (checkValid)
+	{
+		char* try_phrase = state->get_phrase_buffer(this->get_phrase_char_count());
+		this->write_disposition_phrase(usewordset, disposition, try_phrase);
+		if (this->phrase_verifier->match(try_phrase) >= 0)
+		{
+			run_result = DispositionRunResult::Valid;
+			result->push_back(phrase_t()); // Result to contain all valids
+			this->get_disposition_words(usewordset, disposition, &(result->back()));
+			this->count_valid(1);
+		}
+	}
+	else // We just want to analyze the candidates
+	{
+		result->push_back(phrase_t()); // Result to contain all candidates
+		this->get_disposition_words(usewordset, disposition, &(result->back()));
+	}
+
+	return run_result;
+}
+
+// Dispositions are made of usewords, whose letter counts are precomputed: the words are charged
+// against the letters of the phrase, which have to be used up (but for the spaces between them)
+bool Solver::is_disposition_candidate(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState::disposition_t& disposition) const
+{
+	size_t spaces_count = disposition.empty() ? 0 : disposition.size() - 1;
+	size_t length = spaces_count;
+	if (!this->anagram_phrase_layout->is_packable())
+	{
+		Histogram residual(*(this->anagram_phrase_histo));
+		for (DispositionsTreeWalkState::disposition_t::const_iterator it = disposition.begin(); it != disposition.end(); it++)
+		{
+			const Histogram& word_histo = (*(this->use_words_histos))[*it];
+			if (!(residual >= word_histo))
+			{
+				return false;
+			}
+			residual -= word_histo;
+			length += usewordset[*it].length();
+		}
+
+		return length == this->get_phrase_char_count() && residual.get_count(' ') == spaces_count;
+	}
+
+	letter_signature_t residual = this->anagram_phrase_layout->get_letters_signature();
+	for (DispositionsTreeWalkState::disposition_t::const_iterator it = disposition.begin(); it != disposition.end(); it++)
+	{
+		if (!this->anagram_phrase_layout->subtract(&residual, (*(this->use_words_signatures))[*it]))
+		{
+			return false;
+		}
+		length += usewordset[*it].length();
+	}
+
+	return length == this->get_phrase_char_count() && LetterSignatureLayout::is_empty(residual);
+}
+
+// Candidates have the length of the anagram phrase, the verifier rejects most of them
+// before the end of MD5
+bool Solver::check_phrase_hash(const phrase_t& phrase) const
+{
+	return this->match_phrase_hash(phrase) >= 0;
+}
+
+int Solver::match_phrase_hash(const phrase_t& phrase) const
+{
+	return this->phrase_verifier->match(this->phrase_to_string(phrase).c_str());
+}
+
+std::string Solver::phrase_to_string(const phrase_t& phrase) const
+{
+	std::string str_phrase;
+	str_phrase.reserve(this->get_phrase_char_count());
+	for (phrase_t::const_iterator it = phrase.begin(); it != phrase.end(); it++)
+	{
+		if (it != phrase.begin()) str_phrase += ' ';
+		str_phrase += *it;
+	}
+
+	return str_phrase;
+}
+
+// The words are copied one after the other with a space between them: the phrase has to hold
+// their lengths and spaces, the candidates have the length of the anagram phrase
+void Solver::write_disposition_phrase(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState::disposition_t& disposition,
+	char* phrase) const
+{
+	for (DispositionsTreeWalkState::disposition_t::const_iterator it = disposition.begin(); it != disposition.end(); it++)
+	{
+		if (it != disposition.begin()) *(phrase++) = ' ';
+		const std::string& word = usewordset[*it];
+		memcpy(phrase, word.data(), word.length());
+		phrase += word.length();
+	}
+}
+
+void Solver::get_disposition_words(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState::disposition_t& disposition,
+	phrase_t* words) const
+{
+	words->reserve(disposition.size());
+	for (DispositionsTreeWalkState::disposition_t::const_iterator it = disposition.begin(); it != disposition.end(); it++)
+	{
+		words->push_back(usewordset[*it]);
+	}
+}
+
+// Pushes a word to the disposition. When the state carries a budget, the subtree is cut (and
+// nothing is pushed) as soon as the word overdraws a letter of the phrase, or the letters left
+// cannot be spread over the slots left given the shortest and longest useword.
+// The budget is only used when walking the usewords, whose letter counts are precomputed.
+bool Solver::push_word(
+	const usewordset_t& usewordset,
+	unsigned int group_size,
+	const DispositionsTreeWalkState* state,
+	unsigned int index) const
+{
+	if (!state->has_budget())
+	{
+		state->push_to_disposition(index);
+		return true;
+	}
+
+	size_t word_length = usewordset[index].length();
+	bool packed = this->anagram_phrase_layout->is_packable();
+	if (packed ?
+		!state->push_to_disposition(index, (*(this->use_words_signatures))[index], word_length) :
+		!state->push_to_disposition(index, this->use_words_histos->at(index), word_length))
+	{
+		return false;
+	}
+
+	size_t slots_left = group_size - state->get_disposition()->size();
+	size_t residual_length = state->get_residual_length();
+	if (residual_length < slots_left * this->use_words_min_length ||
+		residual_length > slots_left * this->use_words_max_length)
+	{
+		this->pop_word(usewordset, state);
+		return false;
+	}
+
+	return true;
+}
+
+void Solver::pop_word(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState* state) const
 {
-	size_t pos = 0;
-	std::string word;
-	std::string s = phrase;
-	std::string delimiter = " ";
-	std::vector<std::string> result;
-	while ((pos = s.find(delimiter)) != std::string::npos) {
-		word = s.substr(0, pos);
-		result.push_back(word);
-		s.erase(0, pos + delimiter.length());
+	if (!state->has_budget())
+	{
+		state->pop_from_disposition();
+		return;
 	}
 
-	return result;
+	unsigned int index = state->get_disposition()->back();
+	if (this->anagram_phrase_layout->is_packable())
+	{
+		state->pop_from_disposition((*(this->use_words_signatures))[index], usewordset[index].length());
+	}
+	else
+	{
+		state->pop_from_disposition(this->use_words_histos->at(index), usewordset[index].length());
+	}
 }
 
-bool Solver::accept_word(const std::string& word) const
+// Children of a combination node are the indices above the last one: the next member of the class
+// of the last one, then the first member of every following class (see get_next_combination_child).
+// They are only taken from the buckets of the rarest letter left (needs a budget): the letter has
+// to be used up and the usewords are laid out by rarest letter, so the smallest useword left of any
+// completion has it as its rarest letter (a useword with a rarer one does not fit, the others do
+// not have it). Returns the letter (0 when no letter is left), first is raised to its first bucket:
+// any index below is the same first child.
+// Example: letters by rarity x, z, a; buckets x = [0, 1], z = [2, 5], a = [5, 9]; x used up,
+// disposition = [1] => 2, 3, 4 (first = 2, buckets of z)
+char Solver::get_combination_letter(
+	const DispositionsTreeWalkState* state,
+	unsigned int* first) const
 {
-	// Check that every character in the word is present in the anagram phrase
-	for (std::string::const_iterator it = word.begin(); it != word.end(); it++)
+	const DispositionsTreeWalkState::disposition_t& disposition = *(state->get_disposition());
+	*first = disposition.size() == 0 ? 0 : disposition.back() + 1;
+	for (std::vector<char>::const_iterator it = this->use_words_rare_letters->begin();
+		it != this->use_words_rare_letters->end(); it++)
 	{
-		if (this->anagram_phrase.find(*it) == std::string::npos)
+		if (state->has_residual_letter(*it))
 		{
-			// Found a character in word that is not present in anagram_phrase
-			return false;
+			const std::vector<letter_bucket_t>& buckets = (*(this->use_words_letter_buckets))[(unsigned char)*it];
+			if (!buckets.empty() && *first < buckets.front().begin)
+			{
+				*first = buckets.front().begin;
+			}
+			return *it;
 		}
 	}
 
-	// If the character check passes, then consider the histogram
-	return *(this->anagram_phrase_histo) >= Histogram(word);
-}
-
-unsigned int Solver::get_phrase_words_count() const
-{
-	return std::count(
-		this->anagram_phrase.begin(),
-		this->anagram_phrase.end(),
-		' ') + 1;
-}
-
-unsigned int Solver::get_phrase_char_count() const
-{
-	return this->anagram_phrase.length();
+	return 0;
 }
 
-void Solver::walk_dispositions(
+// The buckets are walked in order, skipping the lengths the plan has no slot left for. When they
+// hold many usewords, most of them not fitting the letters left, the trie of the letter yields the
+// classes that fit instead (the usewords of the lengths left are the same): they are collected in
+// the buffer of the depth before they are visited. Lengths from 63 on share a bit of the trie,
+// those classes are checked one by one. The trie is walked with the counts of the letters of the
+// phrase only, the only ones in the usewords
+template <typename Visit>
+void Solver::visit_combination_children(
 	const usewordset_t& usewordset,
 	unsigned int group_size,
+	size_t depth,
 	const DispositionsTreeWalkState* state,
-	result_t* result,
-	bool walkCombinationsOnly) const
+	char letter,
+	unsigned int first,
+	Visit visit) const
 {
-	if (state->get_disposition()->size() == group_size)
+	if (letter == 0)
 	{
-		// Process this disposition as this is a complete disposition (leaf in the recursion-tree)
-		DispositionRunResult run_result = DispositionRunResult::Skipped;
-		// Ordered disposition processing allows us to evaluate only combinations of words. It is the
-		// same concepts as caching, but caching will be really memory-intensive
-		if (!walkCombinationsOnly || (walkCombinationsOnly && state->is_disposition_ordered()))
-		{
-			run_result = this->run_disposition(usewordset, group_size, state, result, !walkCombinationsOnly);
-		}
+		return;
+	}
 
-		bool verbose = false;
-		if (verbose || (run_result != DispositionRunResult::No && run_result != DispositionRunResult::Skipped))
-			this->log("Disposition: " +
-			DispositionsTreeWalkState::get_disposition_words_str(*(state->get_disposition()), usewordset) +
-			" - " + disposition_to_string(*(state->get_disposition())));
+	const std::vector<letter_bucket_t>& buckets = (*(this->use_words_letter_buckets))[(unsigned char)letter];
+	size_t residual_length = state->get_residual_length();
+	uint64_t lengths = 0;
+	size_t scan_size = 0;
+	for (std::vector<letter_bucket_t>::const_iterator bucket = buckets.begin(); bucket != buckets.end(); bucket++)
+	{
+		if (bucket->end <= first || bucket->length > residual_length ||
+			!this->is_plan_length_left(usewordset, state, bucket->length)) continue;
+		lengths |= WordTrie::get_length_bit(bucket->length);
+		scan_size += bucket->end - std::max(first, bucket->begin);
+	}
 
-		if (run_result == DispositionRunResult::Candidate)
-		{
-			this->log("|- Candidate");
-		}
-		else if (run_result == DispositionRunResult::Valid)
-		{
-			this->log("|- Valid => !!FOUND ONE!!");
-		}
-		else if (verbose && run_result == DispositionRunResult::Skipped)
+	if (scan_size < trie_min_scan_size)
+	{
+		for (std::vector<letter_bucket_t>::const_iterator bucket = buckets.begin(); bucket != buckets.end(); bucket++)
 		{
-			this->log("|- Skipped");
+			if (bucket->end <= first || (WordTrie::get_length_bit(bucket->length) & lengths) == 0 ||
+				(bucket->length >= 63 && (bucket->length > residual_length ||
+				!this->is_plan_length_left(usewordset, state, bucket->length)))) continue;
+			for (unsigned int i = std::max(first, bucket->begin); i < bucket->end; i = this->get_next_combination_child(i))
+			{
+				visit(i);
+			}
 		}
 
 		return;
 	}
 
-	// A valid disposition has to be created as state contains an incomplete one
-	// Get residual array: all the indices not contained in state->disposition
-	DispositionsTreeWalkState::disposition_t residuals =
-		this->get_residual_indices(usewordset, *(state->get_disposition()));
-
-	for (
-		DispositionsTreeWalkState::disposition_t::const_iterator it = residuals.begin();
-		it != residuals.end();
-		it++)
+	DispositionsTreeWalkState::disposition_t* children =
+		state->get_children_buffer(depth, group_size);
+	uint8_t counts[Histogram::symbols_count];
+	state->get_residual_counts(counts);
+	children->clear();
+	(*(this->use_words_letter_tries))[(unsigned char)letter].collect(counts, lengths, first, children);
+	bool long_lengths = (lengths & WordTrie::get_length_bit(63)) != 0;
+	for (size_t i = 0; i < children->size(); i++)
 	{
-		// Add the residual to the disposition
-		state->push_to_disposition(*it);
+		unsigned int index = (*children)[i];
+		size_t length = long_lengths ? usewordset[index].length() : 0;
+		if (length >= 63 && (length > residual_length || !this->is_plan_length_left(usewordset, state, length))) continue;
+		visit(index);
+	}
+}
 
-		// Recursively process the new disposition
-		this->walk_dispositions(usewordset, group_size, state, result, walkCombinationsOnly);
+// Without a plan, any length is left
+bool Solver::is_plan_length_left(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState* state,
+	size_t length) const
+{
+	const length_plan_t* plan = state->get_plan();
+	if (!plan)
+	{
+		return true;
+	}
 
-		// Remove the residual as not needed anymore
-		state->pop_from_disposition();
+	size_t left = std::count(plan->lengths.begin(), plan->lengths.end(), length);
+	const DispositionsTreeWalkState::disposition_t& disposition = *(state->get_disposition());
+	for (size_t i = 0; i < disposition.size() && left > 0; i++)
+	{
+		if (usewordset[disposition[i]].length() == length) left--;
 	}
+
+	return left > 0;
 }
 
-Solver::DispositionRunResult Solver::run_disposition(
+// Packs the lengths the plan has slots left for, one byte each in ascending order (0 without a
+// plan). Returns false when they do not fit in a word.
+bool Solver::get_plan_lengths_left_key(
 	const usewordset_t& usewordset,
-	unsigned int group_size,
 	const DispositionsTreeWalkState* state,
-	result_t* result,
-	bool checkValid) const
+	uint64_t* key) const
 {
-	// Build the try-phrase
-	phrase_t try_phrase;
-	for (
-		DispositionsTreeWalkState::disposition_t::const_iterator it = state->get_disposition()->begin();
-		it != state->get_disposition()->end();
-		it++)
+	*key = 0;
+	const length_plan_t* plan = state->get_plan();
+	if (!plan)
 	{
-		unsigned int index = *it;
-		std::string word = usewordset.at(index);
-		try_phrase.push_back(word);
+		return true;
 	}
 
-	// Try the try-phrase
-	// 1. Check the phrase length first
-	// 2. If the length matches, move to the hash check
-	DispositionRunResult run_result = DispositionRunResult::No;
-	if (this->is_phrase_candidate(try_phrase))
+	const DispositionsTreeWalkState::disposition_t& disposition = *(state->get_disposition());
+	unsigned int packed = 0;
+	size_t taken = 0; // Slots of the current length filled by the disposition
+	for (size_t i = 0; i < plan->lengths.size(); i++)
 	{
-		// Candidate, proceed with hash check
-		run_result = DispositionRunResult::Candidate;
-
-		if (checkValid && this->check_phrase_hash(try_phrase))
+		size_t length = plan->lengths[i];
+		if (i == 0 || length != plan->lengths[i - 1])
 		{
-			run_result = DispositionRunResult::Valid;
-			result->push_back(try_phrase); // Result to contain all valids
+			taken = 0;
+			for (size_t j = 0; j < disposition.size(); j++)
+			{
+				if (usewordset[disposition[j]].length() == length) taken++;
+			}
+		}
+		if (taken > 0)
+		{
+			taken--;
+			continue;
 		}
-		else if (!checkValid) // We just want to analyze the candidates
+
+		if (length > 0xFF || packed == sizeof(uint64_t))
 		{
-			result->push_back(try_phrase); // Result to contain all candidates
+			return false;
 		}
+		*key = (*key << 8) | length;
+		packed++;
 	}
 
-	return run_result;
+	return true;
 }
 
-bool Solver::is_phrase_candidate(const phrase_t& phrase) const
+// Every multiset of useword lengths adding up to the letters of the phrase (the phrase less its
+// spaces) becomes a plan.
+// Example: lengths 3 (10 words), 4 (200 words), 5 (50 words), 12 letters, group_size = 3
+// => [3, 4, 5] and [4, 4, 4]
+std::vector<length_plan_t> Solver::get_length_plans(unsigned int group_size) const
 {
-	return this->phrase_to_string(phrase).length() == this->get_phrase_char_count() &&
-		Histogram(this->phrase_to_string(phrase)) == *(this->anagram_phrase_histo);
+	std::vector<length_plan_t> plans;
+	size_t letters_count = this->get_phrase_char_count() - (group_size - 1);
+	std::vector<size_t> lengths;
+	this->collect_length_plans(group_size, letters_count, &lengths, &plans);
+	return plans;
 }
 
-bool Solver::check_phrase_hash(const phrase_t& phrase) const
+void Solver::collect_length_plans(
+	unsigned int group_size,
+	size_t residual_length,
+	std::vector<size_t>* lengths,
+	std::vector<length_plan_t>* plans) const
 {
-	return compare_hashes(
-		this->phrase_hash,
-		get_hash(this->phrase_to_string(phrase)));
+	if (lengths->size() == group_size)
+	{
+		if (residual_length > 0)
+		{
+			return;
+		}
+
+		length_plan_t plan;
+		plan.lengths = *lengths;
+		plans->push_back(plan);
+		return;
+	}
+
+	// Lengths are taken in ascending order, each one as many times as there are usewords of it
+	size_t slots_left = group_size - lengths->size();
+	for (std::map<size_t, unsigned int>::const_iterator it = this->use_words_length_counts->begin();
+		it != this->use_words_length_counts->end(); it++)
+	{
+		size_t length = it->first;
+		if (!lengths->empty() && length < lengths->back()) continue;
+		if (length * slots_left > residual_length) break;
+
+		size_t taken = std::count(lengths->begin(), lengths->end(), length);
+		if (taken >= it->second) continue;
+
+		lengths->push_back(length);
+		this->collect_length_plans(group_size, residual_length - length, lengths, plans);
+		lengths->pop_back();
+	}
 }
 
-std::string Solver::phrase_to_string(const phrase_t& phrase) const
+// Skips the rest of the class of a child, its other members are reached through the child itself
+unsigned int Solver::get_next_combination_child(unsigned int index) const
 {
-	std::string str_phrase;
-	for (phrase_t::const_iterator it = phrase.begin(); it != phrase.end(); it++)
+	return this->use_words_class_ends->at(index);
+}
+
+// The letters left are those of a single class, its first member above the disposition is the
+// only child (needs a packed budget). The class of its rarest letter is in the buckets of the
+// rarest letter left, which is the same: this is the child visit_combination_children would find
+bool Solver::get_last_combination_child(
+	const usewordset_t& usewordset,
+	const DispositionsTreeWalkState* state,
+	unsigned int* index) const
+{
+	std::unordered_map<letter_signature_t, unsigned int, letter_signature_hash_t, letter_signature_equal_t>::const_iterator
+		it = this->use_words_signature_classes->find(*(state->get_residual_signature()));
+	if (it == this->use_words_signature_classes->end())
 	{
-		str_phrase += ((*it) + ((it+1 == phrase.end()) ? "" : " "));
+		return false;
 	}
 
-	return str_phrase;
+	const DispositionsTreeWalkState::disposition_t& disposition = *(state->get_disposition());
+	unsigned int first = disposition.size() == 0 ? 0 : disposition.back() + 1;
+	if ((*(this->use_words_class_ends))[it->second] <= first)
+	{
+		return false;
+	}
+
+	*index = std::max(it->second, first);
+	return this->is_plan_length_left(usewordset, state, usewordset[*index].length());
 }
 
 DispositionsTreeWalkState::disposition_t Solver::get_residual_indices(
@@ -511,6 +2325,97 @@ DispositionsTreeWalkState::disposition_t Solver::get_residual_indices(
 	return ret_disposition;
 }
 
+// --- Solver::PermutationBatch --- //
+
+// Ctors
+
+Solver::PermutationBatch::PermutationBatch(size_t slot_count, size_t phrase_length, size_t capacity)
+	: engine(slot_count)
+{
+	this->phrase_length = phrase_length;
+	this->capacity = capacity;
+	this->count = 0;
+
+	this->offsets = new size_t[slot_count > 0 ? slot_count : 1];
+	this->offsets[0] = 0;
+
+	this->phrases = 0;
+	this->messages = 0;
+	this->block = 0;
+	this->words = 0;
+	this->words_stride = 0;
+	this->message_words = 0;
+	if (phrase_length < md5_single_block_limit)
+	{
+		this->block = new uint32_t[16];
+		initialize_hash_block(phrase_length, this->block);
+		this->phrase = (char*)this->block;
+
+		this->words_stride = (capacity + md5_max_lanes - 1) / md5_max_lanes * md5_max_lanes;
+		this->words = new uint32_t[16 * this->words_stride];
+		for (size_t k = 0; k < 16; k++)
+		{
+			for (size_t i = 0; i < this->words_stride; i++)
+			{
+				this->words[k * this->words_stride + i] = this->block[k];
+			}
+		}
+		this->message_words = phrase_length / 4 + 1; // The last one holds the padding byte
+	}
+	else
+	{
+		this->phrase = new char[phrase_length + 1];
+		this->phrase[phrase_length] = 0;
+
+		this->phrases = new char[capacity * (phrase_length + 1)];
+		this->messages = new const char*[capacity];
+		for (size_t i = 0; i < capacity; i++)
+		{
+			this->phrases[i * (phrase_length + 1) + phrase_length] = 0;
+			this->messages[i] = this->phrases + i * (phrase_length + 1);
+		}
+	}
+	this->permutations = new unsigned int[capacity * (slot_count > 0 ? slot_count : 1)];
+	this->targets = new int[capacity];
+	this->counters = 0;
+}
+
+Solver::PermutationBatch::~PermutationBatch()
+{
+	if (!this->block)
+	{
+		delete[] this->phrase;
+	}
+	delete[] this->offsets;
+	delete[] this->phrases;
+	delete[] this->messages;
+	delete[] this->block;
+	delete[] this->words;
+	delete[] this->permutations;
+	delete[] this->targets;
+}
+
+// --- SolverOptions --- //
+
+// Ctors
+
+SolverOptions::SolverOptions()
+{
+	this->thread_count = 0;
+	this->split_depth = 0;
+	this->pipelined = false;
+	this->hash_thread_count = 0;
+	this->max_results = 0;
+	this->time_limit = std::chrono::milliseconds(0);
+	this->cancel_token = 0;
+	this->checkpoint_interval = std::chrono::seconds(60);
+	this->resume = false;
+	this->stats_stream = 0;
+	this->stats_interval = std::chrono::seconds(10);
+	this->log_level = LogLevel::Info;
+	this->transposition_table_size = (size_t)1 << 16;
+}
+
 // --- DispositionsTreeWalkState --- //
 
 // Ctors
@@ -519,12 +2424,33 @@ DispositionsTreeWalkState::DispositionsTreeWalkState(bool use_cache)
 {
 	this->use_cache = use_cache;
 	this->disposition = new disposition_t();
+	this->budget = 0;
+	this->candidate_queue = 0;
+	this->counters = 0;
+	this->plan = 0;
+	this->transposition_table = 0;
+	this->children = new std::vector<disposition_t>();
+	this->phrase = new std::vector<char>();
 }
 
 DispositionsTreeWalkState::DispositionsTreeWalkState(const DispositionsTreeWalkState& other)
 {
+	this->use_cache = other.use_cache;
 	this->disposition = new disposition_t();
 	*(this->disposition) = *(other.disposition);
+
+	this->budget = 0;
+	if (other.budget)
+	{
+		this->budget = new Budget(*(other.budget));
+	}
+
+	this->candidate_queue = other.candidate_queue;
+	this->counters = other.counters;
+	this->plan = other.plan;
+	this->transposition_table = other.transposition_table;
+	this->children = new std::vector<disposition_t>(); // Scratch, not copied
+	this->phrase = new std::vector<char>();
 }
 
 DispositionsTreeWalkState::~DispositionsTreeWalkState()
@@ -534,6 +2460,23 @@ DispositionsTreeWalkState::~DispositionsTreeWalkState()
 		this->disposition->clear();
 		delete this->disposition;
 	}
+
+	if (this->budget)
+	{
+		delete this->budget;
+	}
+
+	if (this->children)
+	{
+		this->children->clear();
+		delete this->children;
+	}
+
+	if (this->phrase)
+	{
+		this->phrase->clear();
+		delete this->phrase;
+	}
 }
 
 // Public methods
@@ -543,11 +2486,6 @@ const DispositionsTreeWalkState::disposition_t* DispositionsTreeWalkState::get_d
 	return this->disposition; // TODO: return const reference
 }
 
-bool DispositionsTreeWalkState::is_disposition_ordered() const
-{
-	return this->is_disposition_ordered(*(this->get_disposition()));
-}
-
 void DispositionsTreeWalkState::push_to_disposition(unsigned int index) const
 {
 	this->disposition->push_back(index);
@@ -570,28 +2508,184 @@ void DispositionsTreeWalkState::pop_from_disposition() const
 	this->disposition->pop_back();
 }
 
-// Private methods
+// Spaces separate words, so they are not part of the budget. Set it on an empty disposition.
+void DispositionsTreeWalkState::set_budget(const std::string& phrase, const LetterSignatureLayout* layout)
+{
+	if (!this->budget)
+	{
+		this->budget = new Budget();
+	}
+
+	size_t spaces_count = std::count(phrase.begin(), phrase.end(), ' ');
+	this->budget->letters = Histogram(phrase);
+	this->budget->letters -= Histogram(std::string(spaces_count, ' '));
+	this->budget->layout = layout;
+	this->budget->signature.words[0] = this->budget->signature.words[1] = 0;
+	if (layout && layout->is_packable())
+	{
+		this->budget->signature = layout->get_letters_signature();
+	}
+	this->budget->length = phrase.length() - spaces_count;
+}
+
+bool DispositionsTreeWalkState::has_budget() const
+{
+	return this->budget != 0;
+}
+
+void DispositionsTreeWalkState::set_candidate_queue(candidate_queue_t* queue)
+{
+	this->candidate_queue = queue;
+}
+
+DispositionsTreeWalkState::candidate_queue_t* DispositionsTreeWalkState::get_candidate_queue() const
+{
+	return this->candidate_queue;
+}
+
+void DispositionsTreeWalkState::set_counters(SearchCounters* counters)
+{
+	this->counters = counters;
+}
+
+SearchCounters* DispositionsTreeWalkState::get_counters() const
+{
+	return this->counters;
+}
+
+void DispositionsTreeWalkState::set_transposition_table(TranspositionTable* table)
+{
+	this->transposition_table = table;
+}
+
+TranspositionTable* DispositionsTreeWalkState::get_transposition_table() const
+{
+	return this->transposition_table;
+}
+
+// The buffers are all made on the first call, which comes from the outermost node walked: a deeper
+// node never reallocates the buffer of a node still iterating over it
+DispositionsTreeWalkState::disposition_t* DispositionsTreeWalkState::get_children_buffer(size_t depth,
+	size_t max_depth) const
+{
+	if (this->children->size() <= max_depth)
+	{
+		this->children->resize(max_depth + 1);
+	}
+
+	return &((*(this->children))[depth]);
+}
+
+char* DispositionsTreeWalkState::get_phrase_buffer(size_t length) const
+{
+	if (this->phrase->size() <= length)
+	{
+		this->phrase->resize(length + 1);
+	}
+
+	(*(this->phrase))[length] = '\0';
+	return this->phrase->data();
+}
+
+void DispositionsTreeWalkState::set_plan(const length_plan_t* plan) const
+{
+	this->plan = plan;
+}
+
+const length_plan_t* DispositionsTreeWalkState::get_plan() const
+{
+	return this->plan;
+}
+
+size_t DispositionsTreeWalkState::get_residual_length() const
+{
+	return this->budget ? this->budget->length : 0;
+}
 
-// Ordering mst be ascending, fx: 2,4,7
-bool DispositionsTreeWalkState::is_disposition_ordered(const disposition_t& disposition) const
+// Without a budget, any letter may be left
+bool DispositionsTreeWalkState::has_residual_letter(char symbol) const
 {
-	if (disposition.size() <= 1)
+	if (!this->budget)
 	{
 		return true;
 	}
 
-	// Guaranteed at least two elements from here on
-	for (disposition_t::const_iterator it = disposition.begin()+1; it != disposition.end(); it++)
+	return this->budget->layout && this->budget->layout->is_packable() ?
+		this->budget->layout->get_count(this->budget->signature, symbol) > 0 :
+		this->budget->letters.get_count(symbol) > 0;
+}
+
+// Without a budget, any count of any letter may be left
+void DispositionsTreeWalkState::get_residual_counts(uint8_t* counts) const
+{
+	if (!this->budget)
 	{
-		if (!(*it > *(it - 1)))
+		memset(counts, 0xFF, Histogram::symbols_count);
+	}
+	else if (this->budget->layout && this->budget->layout->is_packable())
+	{
+		this->budget->layout->get_counts(this->budget->signature, counts);
+	}
+	else
+	{
+		for (size_t i = 0; i < Histogram::symbols_count; i++)
 		{
-			return false;
+			counts[i] = (uint8_t)this->budget->letters.get_count((char)i);
 		}
 	}
+}
+
+const letter_signature_t* DispositionsTreeWalkState::get_residual_signature() const
+{
+	return this->budget && this->budget->layout && this->budget->layout->is_packable() ?
+		&(this->budget->signature) : 0;
+}
+
+// Nothing is pushed (and the budget is left untouched) if the word overdraws any letter
+bool DispositionsTreeWalkState::push_to_disposition(unsigned int index, const Histogram& word_histo,
+	size_t word_length) const
+{
+	if (word_length > this->budget->length || !(this->budget->letters >= word_histo))
+	{
+		return false;
+	}
+
+	this->budget->letters -= word_histo;
+	this->budget->length -= word_length;
+	this->disposition->push_back(index);
+	return true;
+}
+
+void DispositionsTreeWalkState::pop_from_disposition(const Histogram& word_histo, size_t word_length) const
+{
+	this->budget->letters += word_histo;
+	this->budget->length += word_length;
+	this->disposition->pop_back();
+}
+
+// Same as above on packed letters, the budget has to be set with a packable layout
+bool DispositionsTreeWalkState::push_to_disposition(unsigned int index, const letter_signature_t& word_signature,
+	size_t word_length) const
+{
+	if (word_length > this->budget->length || !this->budget->layout->subtract(&this->budget->signature, word_signature))
+	{
+		return false;
+	}
 
+	this->budget->length -= word_length;
+	this->disposition->push_back(index);
 	return true;
 }
 
+void DispositionsTreeWalkState::pop_from_disposition(const letter_signature_t& word_signature, size_t word_length) const
+{
+	LetterSignatureLayout::add(&this->budget->signature, word_signature);
+	this->budget->length += word_length;
+	this->disposition->pop_back();
+}
+
+// Private methods
+
 std::string DispositionsTreeWalkState::get_disposition_str(const disposition_t& disposition) const
 {
 	return disposition_to_string(disposition);
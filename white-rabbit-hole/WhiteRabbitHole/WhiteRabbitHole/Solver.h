@@ -8,19 +8,65 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
 
 #include "Common.h"
 #include "Histogram.h"
+#include "Hashing.h"
+#include "LetterFilter.h"
+#include "LetterSignature.h"
+#include "TranspositionTable.h"
+#include "WordTrie.h"
+#include "PermutationEngine.h"
+#include "BoundedQueue.h"
+#include "CancelToken.h"
+#include "Checkpoint.h"
+#include "SearchStats.h"
+#include "Logger.h"
 
 namespace challenge {
 	namespace whiterabbithole {
 
+		/// <summary>
+		/// Represents the word lengths of a family of combinations, in ascending order, summing up to
+		/// the letters of the phrase.
+		/// </summary>
+		struct length_plan_t {
+		public:
+			std::vector<size_t> lengths;
+		};
+
+		/// <summary>
+		/// Represents the usewords of one length whose rarest letter is the same: a range of usewords.
+		/// </summary>
+		struct letter_bucket_t {
+		public:
+			size_t length;
+			unsigned int begin;
+			unsigned int end;
+		};
+
 		/// <summary>
 		/// Represents a utility object for algorithmic purposes.
 		/// </summary>
 		struct DispositionsTreeWalkState {
 		public:
 			typedef std::vector<unsigned int> disposition_t;
+			typedef BoundedQueue<phrase_t> candidate_queue_t;
+		private:
+			// Letters (and their total) still to be covered by the words to push, packed when the
+			// layout of the phrase allows it
+			struct Budget {
+				Histogram letters;
+				letter_signature_t signature;
+				const LetterSignatureLayout* layout;
+				size_t length;
+			};
 		public:
 			DispositionsTreeWalkState(bool use_ordering = true);
 			DispositionsTreeWalkState(const DispositionsTreeWalkState& other);
@@ -28,26 +74,160 @@ namespace challenge {
 		private:
 			bool use_cache;
 			disposition_t* disposition;
+			Budget* budget;
+			candidate_queue_t* candidate_queue;
+			SearchCounters* counters;
+			mutable const length_plan_t* plan;
+			TranspositionTable* transposition_table;
+			std::vector<disposition_t>* children;
+			std::vector<char>* phrase;
 		public:
 			const disposition_t* get_disposition() const;
 			void push_to_disposition(unsigned int index) const;
 			void pop_from_disposition() const;
-			bool is_disposition_ordered() const;
+			// Branch-and-bound support: words are charged against the letters of the phrase
+			void set_budget(const std::string& phrase, const LetterSignatureLayout* layout = 0);
+			bool has_budget() const;
+			size_t get_residual_length() const;
+			bool has_residual_letter(char symbol) const;
+			// Counts of the letters left, by unsigned symbol (the symbols out of the phrase are left as is)
+			void get_residual_counts(uint8_t* counts) const;
+			// Packed letters left (null when the budget is not packed)
+			const letter_signature_t* get_residual_signature() const;
+			bool push_to_disposition(unsigned int index, const Histogram& word_histo, size_t word_length) const;
+			void pop_from_disposition(const Histogram& word_histo, size_t word_length) const;
+			bool push_to_disposition(unsigned int index, const letter_signature_t& word_signature, size_t word_length) const;
+			void pop_from_disposition(const letter_signature_t& word_signature, size_t word_length) const;
+			// Pipelined solving: candidates are streamed to the queue instead of being collected
+			void set_candidate_queue(candidate_queue_t* queue);
+			candidate_queue_t* get_candidate_queue() const;
+			// Counters of the thread walking with this state (null for none)
+			void set_counters(SearchCounters* counters);
+			SearchCounters* get_counters() const;
+			// Dead nodes of the thread walking with this state (null for none, not owned)
+			void set_transposition_table(TranspositionTable* table);
+			TranspositionTable* get_transposition_table() const;
+			// Children of the node at a depth, reused by every node of that depth (at most max_depth)
+			disposition_t* get_children_buffer(size_t depth, size_t max_depth) const;
+			// Bytes of the phrase of a leaf, reused by every leaf (length bytes and a terminator)
+			char* get_phrase_buffer(size_t length) const;
+			// Length plan of the combinations walked (null for any length), switched per task
+			void set_plan(const length_plan_t* plan) const;
+			const length_plan_t* get_plan() const;
 			static std::string get_disposition_words_str(const disposition_t& disposition,
 				const std::vector<std::string>& words);
 		private:
-			bool is_disposition_ordered(const disposition_t& disposition) const;
 			std::string get_disposition_str(const disposition_t& disposition) const;
 			std::string get_disposition_str() const;
 		};
 
+		/// <summary>
+		/// Describes the tuning options of a solver.
+		/// </summary>
+		struct SolverOptions {
+		public:
+			SolverOptions();
+		public:
+			/// <summary>
+			/// The number of worker threads. 0 means one per hardware thread, 1 runs
+			/// the solver single-threaded.
+			/// </summary>
+			unsigned int thread_count;
+
+			/// <summary>
+			/// The depth of the dispositions tree whose nodes become parallel tasks.
+			/// 0 lets the solver pick 1 or 2 depending on the number of usewords.
+			/// </summary>
+			unsigned int split_depth;
+
+			/// <summary>
+			/// Whether candidates are hashed while they are searched: the candidate search streams
+			/// them through a bounded queue to a separate pool of hashing threads.
+			/// </summary>
+			bool pipelined;
+
+			/// <summary>
+			/// The number of hashing threads when pipelined. 0 means half the worker threads
+			/// (at least 1).
+			/// </summary>
+			unsigned int hash_thread_count;
+
+			/// <summary>
+			/// The solver stops once it has found this many valid phrases. 0 means no limit.
+			/// </summary>
+			size_t max_results;
+
+			/// <summary>
+			/// The wall-clock time the solver may run for. 0 means no limit.
+			/// </summary>
+			std::chrono::milliseconds time_limit;
+
+			/// <summary>
+			/// A token to stop the solver from outside (not owned). Null means none.
+			/// </summary>
+			CancelToken* cancel_token;
+
+			/// <summary>
+			/// The file the progress is saved to, so that an interrupted solve can resume.
+			/// Empty means no checkpoint.
+			/// </summary>
+			std::string checkpoint_path;
+
+			/// <summary>
+			/// The minimum time between two saves of the checkpoint.
+			/// </summary>
+			std::chrono::seconds checkpoint_interval;
+
+			/// <summary>
+			/// Whether the solve resumes from the checkpoint file, if there is one.
+			/// </summary>
+			bool resume;
+
+			/// <summary>
+			/// The stream the search counters are periodically reported to (not owned). Null means none.
+			/// </summary>
+			std::ostream* stats_stream;
+
+			/// <summary>
+			/// The time between two reports of the search counters.
+			/// </summary>
+			std::chrono::seconds stats_interval;
+
+			/// <summary>
+			/// The file a JSON summary of the search counters is written to at the end of a solve.
+			/// Empty means none.
+			/// </summary>
+			std::string stats_summary_path;
+
+			/// <summary>
+			/// The level of the log records written: candidates are debug records, the progress
+			/// of the phases and the valid phrases info records.
+			/// </summary>
+			LogLevel log_level;
+
+			/// <summary>
+			/// The number of entries of the table each worker keeps of the nodes of the combinations
+			/// tree known to have no candidate below them (see TranspositionTable). 0 disables it.
+			/// </summary>
+			size_t transposition_table_size;
+		};
+
 		/// <summary>
 		/// Describes a solver.
 		/// </summary>
 		class Solver
 		{
+			// Microbenchmarks time the stages of the solver one by one
+			friend class SolverBenchmark;
+
 		public:
 			typedef std::vector<std::vector<std::string>> result_t;
+
+			/// <summary>
+			/// Describes how the last solve ended: run to completion, or stopped early with the
+			/// valid phrases found until then.
+			/// </summary>
+			enum SolveStatus { Running, Completed, ResultLimitReached, DeadlineReached, Cancelled };
 		private:
 			typedef std::vector<std::string> wordset_t;
 			typedef std::vector<std::string> usewordset_t;
@@ -60,8 +240,22 @@ namespace challenge {
 			/// <param name="anagram_phrase">The anagram phrase to handle.</param>
 			/// <param name="dbfile_path">The path to the words file.</param>
 			/// <param name="log_stream">Log stream.</param>
+			/// <param name="options">Tuning options.</param>
 			Solver(const std::string& anagram_phrase, const std::string& dbfile_path,
-				const std::string& phrase_hash, std::ostream& log_stream);
+				const std::string& phrase_hash, std::ostream& log_stream,
+				const SolverOptions& options = SolverOptions());
+
+			/// <summary>
+			/// Initializes a new instance of this class looking for several phrases at once.
+			/// </summary>
+			/// <param name="anagram_phrase">The anagram phrase to handle.</param>
+			/// <param name="dbfile_path">The path to the words file.</param>
+			/// <param name="phrase_hashes">The hashes of the phrases to find.</param>
+			/// <param name="log_stream">Log stream.</param>
+			/// <param name="options">Tuning options.</param>
+			Solver(const std::string& anagram_phrase, const std::string& dbfile_path,
+				const std::vector<std::string>& phrase_hashes, std::ostream& log_stream,
+				const SolverOptions& options = SolverOptions());
 
 			/// <summary>
 			/// Copy initializes a new instance of this class.
@@ -77,13 +271,44 @@ namespace challenge {
 		private:
 			std::string anagram_phrase;
 			std::string dbfile_path;
-			std::string phrase_hash;
+			std::vector<std::string> phrase_hashes;
+			std::vector<digest_t> phrase_digests;
+			HashVerifier* phrase_verifier;
 			std::ostream* log_stream;
+			Logger* logger;
+			mutable std::mutex stats_mutex;
+			SolverOptions options;
 			Histogram* anagram_phrase_histo;
+			LetterSignatureLayout* anagram_phrase_layout;
+			LetterFilter* anagram_phrase_filter;
 			wordset_t* words;
 			usewordset_t* use_words;
+			std::vector<Histogram>* use_words_histos;
+			std::vector<letter_signature_t>* use_words_signatures;
+			std::vector<unsigned int>* use_words_class_ends;
+			std::unordered_map<std::string, unsigned int>* use_words_class_begins;
+			// Class begin of every signature (packed phrases only)
+			std::unordered_map<letter_signature_t, unsigned int, letter_signature_hash_t, letter_signature_equal_t>*
+				use_words_signature_classes;
+			std::map<size_t, unsigned int>* use_words_length_counts;
+			// Letters of the phrase from the rarest in the usewords, and per letter the buckets of the
+			// usewords it is the rarest letter of and the trie of their classes
+			std::vector<char>* use_words_rare_letters;
+			std::vector<std::vector<letter_bucket_t>>* use_words_letter_buckets;
+			std::vector<WordTrie>* use_words_letter_tries;
+			size_t use_words_min_length;
+			size_t use_words_max_length;
 			alphabet_t* alphabet;
 			result_t* result;
+			SolveStatus status;
+			// Why the running solve has to stop (Running while it does not), and the valid
+			// phrases found so far
+			mutable std::atomic<int> stop_status;
+			mutable std::atomic<size_t> valid_count;
+			// Progress of the running solve (null when not checkpointed)
+			Checkpoint* checkpoint;
+			// Counters of the last solve, one slot per worker then per hashing thread
+			SearchStats* stats;
 
 		public:
 			/// <summary>
@@ -97,28 +322,199 @@ namespace challenge {
 			void load_all_res();
 
 			/// <summary>
-			/// Prints the result in the provided stream.
+			/// Prints the result in the provided stream (with the matched hash when there are several).
 			/// </summary>
 			/// <param name="result"></param>
 			/// <param name="stream"></param>
 			void print_result(std::ostream& stream) const;
 
+			/// <summary>
+			/// Gets the valid phrases found by the last solve (partial if it stopped early).
+			/// </summary>
+			const result_t& get_result() const;
+
+			/// <summary>
+			/// Gets how the last solve ended.
+			/// </summary>
+			SolveStatus get_status() const;
+
+			/// <summary>
+			/// Gets the search counters of the running or last solve.
+			/// </summary>
+			search_stats_t get_stats() const;
+
+			/// <summary>
+			/// Gets the name of a solve status.
+			/// </summary>
+			static std::string get_status_name(SolveStatus status);
+
 		private:
-			void log(const std::string& what) const;
+			typedef std::function<void(size_t task, unsigned int worker, const DispositionsTreeWalkState* state,
+				result_t* result)> walk_task_t;
+
+			// Phrases of the permutations of a combination, queued for the batch hash verification.
+			// A worker reuses its batch across combinations: nothing is allocated per permutation
+			struct PermutationBatch {
+			public:
+				PermutationBatch(size_t slot_count, size_t phrase_length, size_t capacity);
+				~PermutationBatch();
+			private:
+				PermutationBatch(const PermutationBatch& other);
+			public:
+				PermutationEngine engine;
+				size_t phrase_length;
+				size_t capacity;
+				size_t count;
+				// The phrase of the current permutation and where each of its words starts
+				char* phrase;
+				size_t* offsets;
+				// Single-block phrases are queued as their MD5 blocks, word by word (see
+				// HashVerifier::match_words): the phrase is written in block, whose padding and length
+				// are set once like those of the queued blocks, only its first message_words are copied
+				char* phrases;
+				const char** messages;
+				uint32_t* block;
+				uint32_t* words;
+				size_t words_stride;
+				size_t message_words;
+				unsigned int* permutations;
+				int* targets;
+				SearchCounters* counters;
+			};
+
+		private:
+			void log(LogLevel level, const std::string& what) const;
+			void run_phases(unsigned int words_count);
+			void write_stats_summary() const;
+			std::string get_checkpoint_fingerprint() const;
+			bool is_stop_requested() const;
+			void request_stop(SolveStatus reason) const;
+			void count_valid(size_t count) const;
+			unsigned int get_thread_count() const;
+			unsigned int get_split_depth(unsigned int group_size) const;
+			unsigned int get_hash_thread_count() const;
 			unsigned int get_disposition_count(unsigned int group_size) const;
 			bool check_dbfile_path() const;
-			void load_words();
+			size_t load_words();
 			void process_words();
 			std::vector<std::string> get_words_in_phrase(const std::string& phrase) const;
+			std::string get_word_signature(const std::string& word) const;
 			bool accept_word(const std::string& word) const;
 			unsigned int get_phrase_words_count() const;
 			unsigned int get_phrase_char_count() const;
-			void walk_dispositions(
+			void search_candidates(unsigned int group_size, result_t* result, bool walkCombinationsOnly,
+				DispositionsTreeWalkState::candidate_queue_t* candidate_queue = 0) const;
+			void search_pipelined(unsigned int group_size, result_t* result, size_t* candidates_count) const;
+			void search_valid_dispositions(const result_t& combinations, unsigned int group_size,
+				result_t* result) const;
+			void verify_combination(const phrase_t& combination, PermutationBatch* batch, result_t* result) const;
+			void verify_permutations(const phrase_t& words, PermutationBatch* batch, result_t* result) const;
+			void write_permutation_phrase(const phrase_t& words, size_t from_position, PermutationBatch* batch) const;
+			void flush_permutation_batch(const phrase_t& words, PermutationBatch* batch, result_t* result) const;
+			void expand_combination(const phrase_t& combination, std::vector<phrase_t>* expanded) const;
+			void expand_classes(
+				const std::vector<std::pair<unsigned int, unsigned int>>& classes,
+				size_t class_index,
+				unsigned int taken,
+				unsigned int from,
+				phrase_t* phrase,
+				std::vector<phrase_t>* expanded) const;
+			void run_walk_tasks(size_t task_count, const walk_task_t& task, result_t* result,
+				bool use_budget, DispositionsTreeWalkState::candidate_queue_t* candidate_queue = 0) const;
+			void collect_prefixes(
+				const usewordset_t& usewordset,
+				unsigned int group_size,
+				unsigned int depth,
+				const DispositionsTreeWalkState* state,
+				std::vector<DispositionsTreeWalkState::disposition_t>* prefixes,
+				bool walkCombinationsOnly) const;
+			bool walk_dispositions(
+				const usewordset_t& usewordset,
+				unsigned int group_size,
+				const DispositionsTreeWalkState* state,
+				result_t* result,
+				bool walkCombinationsOnly) const;
+			bool walk_combinations(
+				const usewordset_t& usewordset,
+				unsigned int group_size,
+				const DispositionsTreeWalkState* state,
+				result_t* result) const;
+			template <unsigned int GroupSize, unsigned int Depth>
+			bool enter_combinations_kernel(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState* state,
+				result_t* result,
+				std::false_type) const;
+			template <unsigned int GroupSize, unsigned int Depth>
+			bool enter_combinations_kernel(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState* state,
+				result_t* result,
+				std::true_type) const;
+			template <unsigned int GroupSize, unsigned int Depth>
+			bool walk_combinations_kernel(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState* state,
+				result_t* result,
+				std::false_type) const;
+			template <unsigned int GroupSize, unsigned int Depth>
+			bool walk_combinations_kernel(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState* state,
+				result_t* result,
+				std::true_type) const;
+			template <typename WalkChild>
+			bool walk_combination_node(
+				const usewordset_t& usewordset,
+				unsigned int group_size,
+				size_t depth,
+				const DispositionsTreeWalkState* state,
+				WalkChild walk_child) const;
+			bool evaluate_disposition(
 				const usewordset_t& usewordset,
 				unsigned int group_size,
 				const DispositionsTreeWalkState* state,
 				result_t* result,
 				bool walkCombinationsOnly) const;
+			bool push_word(
+				const usewordset_t& usewordset,
+				unsigned int group_size,
+				const DispositionsTreeWalkState* state,
+				unsigned int index) const;
+			void pop_word(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState* state) const;
+			std::vector<length_plan_t> get_length_plans(unsigned int group_size) const;
+			void collect_length_plans(
+				unsigned int group_size,
+				size_t residual_length,
+				std::vector<size_t>* lengths,
+				std::vector<length_plan_t>* plans) const;
+			char get_combination_letter(
+				const DispositionsTreeWalkState* state,
+				unsigned int* first) const;
+			template <typename Visit>
+			void visit_combination_children(
+				const usewordset_t& usewordset,
+				unsigned int group_size,
+				size_t depth,
+				const DispositionsTreeWalkState* state,
+				char letter,
+				unsigned int first,
+				Visit visit) const;
+			bool is_plan_length_left(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState* state,
+				size_t length) const;
+			bool get_plan_lengths_left_key(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState* state,
+				uint64_t* key) const;
+			unsigned int get_next_combination_child(unsigned int index) const;
+			bool get_last_combination_child(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState* state,
+				unsigned int* index) const;
 			DispositionsTreeWalkState::disposition_t get_residual_indices(
 				const usewordset_t& usewordset,
 				const DispositionsTreeWalkState::disposition_t& disposition) const;
@@ -128,9 +524,20 @@ namespace challenge {
 				const DispositionsTreeWalkState* state,
 				result_t* result,
 				bool checkValid) const;
-			bool is_phrase_candidate(const phrase_t& phrase) const;
+			bool is_disposition_candidate(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState::disposition_t& disposition) const;
 			bool check_phrase_hash(const phrase_t& phrase) const;
+			int match_phrase_hash(const phrase_t& phrase) const;
 			std::string phrase_to_string(const phrase_t& phrase) const;
+			void write_disposition_phrase(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState::disposition_t& disposition,
+				char* phrase) const;
+			void get_disposition_words(
+				const usewordset_t& usewordset,
+				const DispositionsTreeWalkState::disposition_t& disposition,
+				phrase_t* words) const;
 		}; // class Solver
 
 	} // namespace whiterabbithole
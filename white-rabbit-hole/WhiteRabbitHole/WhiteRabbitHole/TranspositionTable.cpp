@@ -0,0 +1,71 @@
+// TranspositionTable.cpp
+
+#include <cstring>
+
+#include "TranspositionTable.h"
+
+using namespace challenge::whiterabbithole;
+
+// Ctors
+
+TranspositionTable::TranspositionTable(size_t capacity)
+{
+	size_t size = 1;
+	while (size * 2 <= capacity) size *= 2;
+	this->entries = new transposition_key_t[size];
+	this->mask = size - 1;
+	this->clear();
+}
+
+TranspositionTable::~TranspositionTable()
+{
+	delete[] this->entries;
+}
+
+// Public methods
+
+size_t TranspositionTable::get_capacity() const
+{
+	return this->mask + 1;
+}
+
+bool TranspositionTable::contains(const transposition_key_t& key) const
+{
+	return equals(this->entries[this->get_entry_index(key)], key);
+}
+
+bool TranspositionTable::insert(const transposition_key_t& key)
+{
+	transposition_key_t& entry = this->entries[this->get_entry_index(key)];
+	bool evicted = entry.slots_left != 0 && !equals(entry, key);
+	entry = key;
+	return evicted;
+}
+
+void TranspositionTable::clear()
+{
+	memset(this->entries, 0, (this->mask + 1) * sizeof(transposition_key_t));
+}
+
+// Private methods
+
+// The fields are folded into one word, then mixed by the finalizer of MurmurHash3 so that every
+// bit of the key reaches the low bits picking the entry
+size_t TranspositionTable::get_entry_index(const transposition_key_t& key) const
+{
+	uint64_t hash = key.residual.words[0] * 0x9E3779B97F4A7C15ULL;
+	hash ^= key.residual.words[1] + 0x632BE59BD9B4E019ULL + (hash << 6) + (hash >> 2);
+	hash ^= key.lengths + ((uint64_t)key.first << 32 | key.slots_left);
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	return (size_t)hash & this->mask;
+}
+
+bool TranspositionTable::equals(const transposition_key_t& key1, const transposition_key_t& key2)
+{
+	return LetterSignatureLayout::equals(key1.residual, key2.residual) && key1.lengths == key2.lengths &&
+		key1.first == key2.first && key1.slots_left == key2.slots_left;
+}
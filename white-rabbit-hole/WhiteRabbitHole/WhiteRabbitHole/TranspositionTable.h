@@ -0,0 +1,86 @@
+// TranspositionTable.h
+
+#ifndef TRANSPOSITIONTABLE_H_
+#define TRANSPOSITIONTABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "LetterSignature.h"
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Identifies a node of the combinations tree by what its subtree depends on: the letters
+		/// left, the slots left, the first index its children may take and the word lengths the plan
+		/// has slots left for. Nodes reached by different prefixes with the same key have the same subtree.
+		/// </summary>
+		struct transposition_key_t {
+		public:
+			letter_signature_t residual;
+			uint64_t lengths;
+			uint32_t first;
+			uint32_t slots_left; // Never 0 for a stored node, 0 marks an empty entry
+		};
+
+		/// <summary>
+		/// Remembers the nodes of the combinations tree known to have no candidate below them.
+		/// The table is bounded and lossy: it is direct-mapped and a new node replaces whatever
+		/// was in its entry, so a node may be forgotten but is never mistaken for another one
+		/// (the whole key is stored). Not thread-safe, every worker owns its own.
+		/// </summary>
+		class TranspositionTable
+		{
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="capacity">The number of entries, rounded down to a power of two.</param>
+			TranspositionTable(size_t capacity);
+
+			/// <summary>
+			/// Destroys an instance of this class.
+			/// </summary>
+			~TranspositionTable();
+
+		private:
+			TranspositionTable(const TranspositionTable& other);
+
+		private:
+			transposition_key_t* entries;
+			size_t mask;
+
+		public:
+			/// <summary>
+			/// Gets the number of entries.
+			/// </summary>
+			size_t get_capacity() const;
+
+			/// <summary>
+			/// Checks whether a node is known to have no candidate below it.
+			/// </summary>
+			/// <param name="key">The key of the node.</param>
+			bool contains(const transposition_key_t& key) const;
+
+			/// <summary>
+			/// Records a node with no candidate below it.
+			/// </summary>
+			/// <param name="key">The key of the node.</param>
+			/// <returns>A value indicating whether another node was evicted.</returns>
+			bool insert(const transposition_key_t& key);
+
+			/// <summary>
+			/// Forgets all nodes.
+			/// </summary>
+			void clear();
+
+		private:
+			size_t get_entry_index(const transposition_key_t& key) const;
+			static bool equals(const transposition_key_t& key1, const transposition_key_t& key2);
+		}; // class TranspositionTable
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
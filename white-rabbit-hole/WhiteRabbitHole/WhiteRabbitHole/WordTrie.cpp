@@ -0,0 +1,118 @@
+// WordTrie.cpp
+
+#include <algorithm>
+
+#include "WordTrie.h"
+
+using namespace challenge::whiterabbithole;
+
+// Ctors
+
+WordTrie::WordTrie()
+{
+	this->begin = 0;
+}
+
+WordTrie::WordTrie(std::vector<word_trie_entry_t> entries)
+{
+	this->begin = 0;
+	if (entries.empty())
+	{
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(),
+		[](const word_trie_entry_t& entry1, const word_trie_entry_t& entry2) { return entry1.letters < entry2.letters; });
+	Node root = { 0, 0, 0, 0, 0, 0, 0 };
+	this->nodes.push_back(root);
+	this->begin = this->build(0, entries, 0, entries.size(), 0);
+}
+
+// Public methods
+
+bool WordTrie::is_empty() const
+{
+	return this->nodes.empty();
+}
+
+unsigned int WordTrie::get_begin() const
+{
+	return this->begin;
+}
+
+void WordTrie::collect(uint8_t* counts, uint64_t lengths, unsigned int first,
+	std::vector<unsigned int>* indices) const
+{
+	if (!this->nodes.empty() && this->nodes.front().subtree_end > first && (this->nodes.front().lengths & lengths) != 0)
+	{
+		this->collect(this->nodes.front(), 0, counts, lengths, first, indices);
+	}
+}
+
+// Private methods
+
+// Fills the node of the sorted entries [from, to) sharing their first depth letters: the entry
+// ending there comes first (sorted before its extensions), the others are split by their next
+// letter. The children are all appended before any of them is filled, so that they are next to
+// each other. Returns the lowest useword index at or below the node
+unsigned int WordTrie::build(unsigned int node_index, const std::vector<word_trie_entry_t>& entries,
+	size_t from, size_t to, size_t depth)
+{
+	Node node = this->nodes[node_index];
+	unsigned int begin = UINT32_MAX;
+	if (entries[from].letters.length() == depth)
+	{
+		node.lengths = get_length_bit(depth);
+		node.begin = entries[from].begin;
+		node.end = entries[from].end;
+		node.subtree_end = node.end;
+		begin = node.begin;
+		from++;
+	}
+
+	std::vector<size_t> groups;
+	for (size_t i = from; i < to; i++)
+	{
+		if (i == from || entries[i].letters[depth] != entries[i - 1].letters[depth]) groups.push_back(i);
+	}
+	groups.push_back(to);
+	node.children_begin = (unsigned int)this->nodes.size();
+	node.children_end = node.children_begin + (unsigned int)(groups.size() - 1);
+	for (size_t i = 0; i + 1 < groups.size(); i++)
+	{
+		Node child = { 0, 0, 0, 0, 0, 0, entries[groups[i]].letters[depth] };
+		this->nodes.push_back(child);
+	}
+
+	for (size_t i = 0; i + 1 < groups.size(); i++)
+	{
+		unsigned int child_index = node.children_begin + (unsigned int)i;
+		begin = std::min(begin, this->build(child_index, entries, groups[i], groups[i + 1], depth + 1));
+		node.lengths |= this->nodes[child_index].lengths;
+		node.subtree_end = std::max(node.subtree_end, this->nodes[child_index].subtree_end);
+	}
+	this->nodes[node_index] = node;
+
+	return begin;
+}
+
+// Letters are taken in ascending order along a path, each while its count lasts. A child is only
+// entered when it may lead to a class to collect
+void WordTrie::collect(const Node& node, size_t depth, uint8_t* counts, uint64_t lengths,
+	unsigned int first, std::vector<unsigned int>* indices) const
+{
+	if (node.end > first && (get_length_bit(depth) & lengths) != 0)
+	{
+		indices->push_back(std::max(node.begin, first));
+	}
+
+	for (unsigned int i = node.children_begin; i < node.children_end; i++)
+	{
+		const Node& child = this->nodes[i];
+		uint8_t& count = counts[(unsigned char)child.letter];
+		if (count == 0 || child.subtree_end <= first || (child.lengths & lengths) == 0) continue;
+		count--;
+		this->collect(child, depth + 1, counts, lengths, first, indices);
+		count++;
+	}
+}
@@ -0,0 +1,105 @@
+// WordTrie.h
+
+#ifndef WORDTRIE_H_
+#define WORDTRIE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Represents a class of anagrams to index: its letters in ascending order and its range of usewords.
+		/// </summary>
+		struct word_trie_entry_t {
+		public:
+			std::string letters;
+			unsigned int begin;
+			unsigned int end;
+		};
+
+		/// <summary>
+		/// Indexes classes of anagrams by their sorted letters, so that the classes spellable from a
+		/// multiset of letters are generated directly: a path only goes on while its letter has a count
+		/// left, and classes sharing a prefix that does not fit are given up at once. Every node also
+		/// knows the lengths of the classes below it, so that a path with none of the lengths asked
+		/// for is given up as well.
+		/// Nodes are stored in one flat array, every node being the edge from its parent: the children
+		/// of a node are next to each other, so that choosing the edges to follow reads a single run.
+		/// </summary>
+		class WordTrie
+		{
+		public:
+			/// <summary>
+			/// Initializes a new empty instance of this class.
+			/// </summary>
+			WordTrie();
+
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="entries">The classes to index, with distinct letters.</param>
+			WordTrie(std::vector<word_trie_entry_t> entries);
+
+		private:
+			// A node is reached through letter and ends the letters of the class [begin, end) (empty
+			// when none); the classes at or below it end before subtree_end, their length bits are in
+			// lengths. Its children are the nodes [children_begin, children_end)
+			struct Node {
+				uint64_t lengths;
+				unsigned int children_begin;
+				unsigned int children_end;
+				unsigned int begin;
+				unsigned int end;
+				unsigned int subtree_end;
+				char letter;
+			};
+
+		private:
+			std::vector<Node> nodes; // The root first
+			unsigned int begin;
+
+		public:
+			/// <summary>
+			/// Gets a value indicating whether no class is indexed.
+			/// </summary>
+			bool is_empty() const;
+
+			/// <summary>
+			/// Gets the lowest useword index of the classes (0 when empty).
+			/// </summary>
+			unsigned int get_begin() const;
+
+			/// <summary>
+			/// Gets the bit of a length in a set of lengths: the lengths from 63 on share the last bit.
+			/// </summary>
+			static inline uint64_t get_length_bit(size_t length)
+			{
+				return (uint64_t)1 << (length < 63 ? length : 63);
+			}
+
+			/// <summary>
+			/// Collects the classes spellable from a multiset of letters.
+			/// </summary>
+			/// <param name="counts">The count of every symbol (by unsigned value), left as is on return.</param>
+			/// <param name="lengths">The bits of the lengths of the classes to collect (see get_length_bit).</param>
+			/// <param name="first">The lowest useword index to collect: a class is collected from its first
+			/// useword at or above it, and skipped when none is.</param>
+			/// <param name="indices">The collected useword indices, one per class, appended.</param>
+			void collect(uint8_t* counts, uint64_t lengths, unsigned int first,
+				std::vector<unsigned int>* indices) const;
+
+		private:
+			unsigned int build(unsigned int node_index, const std::vector<word_trie_entry_t>& entries,
+				size_t from, size_t to, size_t depth);
+			void collect(const Node& node, size_t depth, uint8_t* counts, uint64_t lengths,
+				unsigned int first, std::vector<unsigned int>* indices) const;
+		}; // class WordTrie
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif
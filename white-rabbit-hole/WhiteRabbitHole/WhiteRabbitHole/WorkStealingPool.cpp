@@ -0,0 +1,147 @@
+// WorkStealingPool.cpp
+
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "WorkStealingPool.h"
+
+using namespace challenge::whiterabbithole;
+
+// Ctors
+
+WorkStealingPool::WorkStealingPool(unsigned int thread_count)
+{
+	this->thread_count = thread_count == 0 ? 1 : thread_count;
+	this->queues = new WorkerQueue[this->thread_count];
+	for (unsigned int i = 0; i < this->thread_count; i++)
+	{
+		this->queues[i].begin = 0;
+		this->queues[i].end = 0;
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	if (this->queues)
+	{
+		delete[] this->queues;
+	}
+}
+
+// Public methods
+
+unsigned int WorkStealingPool::get_thread_count() const
+{
+	return this->thread_count;
+}
+
+void WorkStealingPool::run(size_t task_count, const task_body_t& body)
+{
+	if (task_count == 0)
+	{
+		return;
+	}
+
+	// Split the index space evenly, stealing will take care of the imbalance
+	for (unsigned int i = 0; i < this->thread_count; i++)
+	{
+		std::lock_guard<std::mutex> guard(this->queues[i].lock);
+		this->queues[i].begin = task_count * i / this->thread_count;
+		this->queues[i].end = task_count * (i + 1) / this->thread_count;
+	}
+
+	// On failure, record the first error and drain all queues so that workers stop
+	std::exception_ptr error;
+	std::mutex error_lock;
+	task_body_t guarded_body = [&](size_t task, unsigned int worker)
+	{
+		try
+		{
+			body(task, worker);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> guard(error_lock);
+			if (!error) error = std::current_exception();
+			for (unsigned int i = 0; i < this->thread_count; i++)
+			{
+				std::lock_guard<std::mutex> queue_guard(this->queues[i].lock);
+				this->queues[i].begin = this->queues[i].end;
+			}
+		}
+	};
+
+	// The calling thread acts as worker 0
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < this->thread_count; i++)
+	{
+		threads.push_back(std::thread(&WorkStealingPool::work, this, i, std::cref(guarded_body)));
+	}
+	this->work(0, guarded_body);
+	for (std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++)
+	{
+		it->join();
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+// Private methods
+
+void WorkStealingPool::work(unsigned int worker, const task_body_t& body)
+{
+	size_t task;
+	while (this->pop(worker, task) || this->steal(worker, task))
+	{
+		body(task, worker);
+	}
+}
+
+// Owner takes tasks from the front of its range
+bool WorkStealingPool::pop(unsigned int worker, size_t& task)
+{
+	WorkerQueue& queue = this->queues[worker];
+	std::lock_guard<std::mutex> guard(queue.lock);
+	if (queue.begin == queue.end)
+	{
+		return false;
+	}
+
+	task = queue.begin++;
+	return true;
+}
+
+// Thieves take the back half of a victim's range, run its first task and keep the rest
+bool WorkStealingPool::steal(unsigned int worker, size_t& task)
+{
+	for (unsigned int i = 1; i < this->thread_count; i++)
+	{
+		WorkerQueue& victim = this->queues[(worker + i) % this->thread_count];
+		size_t stolen_begin, stolen_end;
+		{
+			std::lock_guard<std::mutex> guard(victim.lock);
+			size_t available = victim.end - victim.begin;
+			if (available == 0)
+			{
+				continue;
+			}
+
+			stolen_begin = victim.end - (available + 1) / 2;
+			stolen_end = victim.end;
+			victim.end = stolen_begin;
+		}
+
+		task = stolen_begin;
+		WorkerQueue& own = this->queues[worker];
+		std::lock_guard<std::mutex> guard(own.lock);
+		own.begin = stolen_begin + 1;
+		own.end = stolen_end;
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,77 @@
+// WorkStealingPool.h
+
+#ifndef WORKSTEALINGPOOL_H_
+#define WORKSTEALINGPOOL_H_
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+namespace challenge {
+	namespace whiterabbithole {
+
+		/// <summary>
+		/// Runs a set of indexed tasks on a pool of threads. Every worker owns a range of
+		/// task indices and, when it runs out of work, steals half of the range of another worker.
+		/// </summary>
+		class WorkStealingPool
+		{
+		public:
+			/// <summary>
+			/// The body of a task: receives the task index and the index of the worker running it.
+			/// </summary>
+			typedef std::function<void(size_t task, unsigned int worker)> task_body_t;
+
+		private:
+			// Padded to a cache line so that workers do not false-share their queues
+			struct WorkerQueue {
+				std::mutex lock;
+				size_t begin;
+				size_t end;
+				char padding[64];
+			};
+
+		public:
+			/// <summary>
+			/// Initializes a new instance of this class.
+			/// </summary>
+			/// <param name="thread_count">The number of worker threads (at least 1).</param>
+			WorkStealingPool(unsigned int thread_count);
+
+			/// <summary>
+			/// Destroys an instance of this class.
+			/// </summary>
+			~WorkStealingPool();
+
+		private:
+			WorkStealingPool(const WorkStealingPool& other);
+
+		private:
+			unsigned int thread_count;
+			WorkerQueue* queues;
+
+		public:
+			/// <summary>
+			/// Gets the number of workers.
+			/// </summary>
+			unsigned int get_thread_count() const;
+
+			/// <summary>
+			/// Runs tasks [0, task_count) and blocks until all of them have completed.
+			/// Every task is run exactly once. If a task throws, the first exception is
+			/// rethrown here once all workers have stopped.
+			/// </summary>
+			/// <param name="task_count">The number of tasks.</param>
+			/// <param name="body">The task body.</param>
+			void run(size_t task_count, const task_body_t& body);
+
+		private:
+			void work(unsigned int worker, const task_body_t& body);
+			bool pop(unsigned int worker, size_t& task);
+			bool steal(unsigned int worker, size_t& task);
+		}; // class WorkStealingPool
+
+	} // namespace whiterabbithole
+} // namespace challenge
+
+#endif